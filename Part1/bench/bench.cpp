@@ -0,0 +1,304 @@
+#include "../src/blockTree.hpp"
+#include "../src/calendarQueue.hpp"
+#include "../src/event.hpp"
+#include "../src/utils.hpp"
+#include <filesystem>
+
+/*
+    Microbenchmarks of the simulator's hot paths, run by `make bench`
+    1) Every benchmark builds its input from a fixed seed outside the timed region, then times the operation
+       REPEATS times and keeps the fastest run (the least disturbed by the machine)
+    2) Results are written as JSON, one entry per benchmark with its size n, the number of timed operations,
+       the fastest run in seconds and the cost per operation
+*/
+
+static const uint64_t SEED = 42;
+static const int REPEATS = 5;
+
+static Counter ids;             // Id source of every block and transaction the benchmarks build
+static volatile size_t sink;    // Keeps results that are otherwise unused from being optimised away
+
+struct Result {
+    std::string name;
+    size_t n;
+    size_t ops;
+    double seconds;
+};
+
+static double elapsed(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/*
+    Runs body REPEATS times, body returns the seconds spent in its timed region
+*/
+static Result measure(const std::string & name, size_t n, size_t ops, const std::function<double()> & body) {
+    double best = std::numeric_limits<double>::max();
+    for (int i = 0; i < REPEATS; i++) {
+        best = std::min(best, body());
+    }
+    std::cerr << name << " n=" << n << ": " << best * 1e9 / ops << " ns/op" << std::endl;
+    return Result{name, n, ops, best};
+}
+
+static BlockPtr coinbaseBlock(blockId_t parentId, uint64_t height, minerId_t owner) {
+    blockId_t blockId = ids.getBlockID(parentId);
+    txnId_t txnId = ids.getTxnID();
+    std::vector<Transaction> transactions;
+    transactions.push_back(Transaction(txnId, {}, {Utxo(blockId, txnId, 0, owner, MINING_REWARD)}, TransactionType::COINBASE));
+    return BlockStore::intern(std::make_shared<const Block>(blockId, height, parentId, std::move(transactions), height));
+}
+
+/*
+    Blocks whose parent is drawn among the window most recent ones: 1 gives a linear chain, larger windows a bushy tree
+    with frequent reorgs; blocks pay owner
+*/
+static std::vector<BlockPtr> buildTree(size_t n, size_t window, minerId_t owner, RandomStream & rng) {
+    std::vector<BlockPtr> blocks;
+    blocks.reserve(n);
+    for (size_t i = 0; i < n; i++) {
+        size_t recent = std::min(window, blocks.size());
+        BlockPtr parent = recent == 0 ? BlockStore::genesis() : blocks[blocks.size() - 1 - rng() % recent];
+        blocks.push_back(coinbaseBlock(parent->id, parent->height + 1, owner));
+    }
+    return blocks;
+}
+
+/*
+    Two branches from the genesis, each one overtaking the other in turn: every switch disconnects and reconnects
+    whole branches, so the cost is dominated by findLCA and the deltas of deep reorgs
+*/
+static std::vector<BlockPtr> buildRacingBranches(size_t n) {
+    std::vector<BlockPtr> blocks;
+    BlockPtr tips[2] = {BlockStore::genesis(), BlockStore::genesis()};
+    for (size_t i = 0; blocks.size() < n; i++) {
+        // Branch i % 2 grows two blocks past the other one
+        BlockPtr & tip = tips[i % 2];
+        while (tip->height <= tips[(i + 1) % 2]->height + 1 && blocks.size() < n) {
+            tip = coinbaseBlock(tip->id, tip->height + 1, 1);
+            blocks.push_back(tip);
+        }
+    }
+    return blocks;
+}
+
+static Result benchAddBlock(const std::string & name, const std::vector<BlockPtr> & blocks) {
+    return measure(name, blocks.size(), blocks.size(), [&]() {
+        BlockTree tree(0);
+        MemPool memPool;
+        auto start = std::chrono::steady_clock::now();
+        for (const BlockPtr & block : blocks) {
+            tree.addBlock(block, block->timestamp, memPool);
+        }
+        return elapsed(start);
+    });
+}
+
+/*
+    Reaches the private ancestor queries of a tree
+*/
+struct BlockTreeBench {
+    static nodeId_t findLCA(const BlockTree & tree, nodeId_t node1, nodeId_t node2) {
+        return tree.findLCA(node1, node2);
+    }
+
+    static size_t size(const BlockTree & tree) {
+        return tree.nodes.size();
+    }
+};
+
+/*
+    findLCA alone, on random node pairs of a tree built from blocks, the pairs drawn outside the timed region
+*/
+static Result benchFindLCA(const std::string & name, const std::vector<BlockPtr> & blocks, size_t queries, RandomStream & rng) {
+    BlockTree tree(0);
+    MemPool memPool;
+    for (const BlockPtr & block : blocks) {
+        tree.addBlock(block, block->timestamp, memPool);
+    }
+    size_t nodes = BlockTreeBench::size(tree);
+    std::vector<std::pair<nodeId_t, nodeId_t>> pairs(queries);
+    for (auto & pair : pairs) {
+        pair = {static_cast<nodeId_t>(rng() % nodes), static_cast<nodeId_t>(rng() % nodes)};
+    }
+    return measure(name, blocks.size(), queries, [&]() {
+        size_t total = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (const auto & pair : pairs) {
+            total += BlockTreeBench::findLCA(tree, pair.first, pair.second);
+        }
+        double seconds = elapsed(start);
+        sink += total;
+        return seconds;
+    });
+}
+
+static Result benchGetUtxos(size_t n, RandomStream & rng) {
+    std::vector<BlockPtr> blocks = buildTree(n, 1, 0, rng);
+    std::vector<int> amounts(n / 2);
+    for (int & amount : amounts) {
+        amount = 1 + rng() % (2 * MINING_REWARD);
+    }
+    return measure("blockTree.getUtxos", n, amounts.size(), [&]() {
+        BlockTree tree(0);
+        MemPool memPool;
+        for (const BlockPtr & block : blocks) {
+            tree.addBlock(block, block->timestamp, memPool);
+        }
+        int change;
+        auto start = std::chrono::steady_clock::now();
+        for (int amount : amounts) {
+            tree.getUtxos(amount, change);
+        }
+        return elapsed(start);
+    });
+}
+
+static std::vector<TransactionPtr> makeTransactions(size_t n) {
+    std::vector<TransactionPtr> transactions;
+    transactions.reserve(n);
+    for (size_t i = 0; i < n; i++) {
+        txnId_t txnId = ids.getTxnID();
+        std::vector<Outpoint> inputs{Outpoint{i + 1, i, 0}};
+        std::vector<Utxo> outputs{Utxo(-1, txnId, 0, 1, 7), Utxo(-1, txnId, 1, 0, 3)};
+        transactions.push_back(std::make_shared<const Transaction>(txnId, inputs, outputs, TransactionType::NORMAL));
+    }
+    return transactions;
+}
+
+static Result benchMemPool(size_t n) {
+    std::vector<TransactionPtr> transactions = makeTransactions(n);
+    return measure("memPool.insertErase", n, 2 * n, [&]() {
+        MemPool memPool;
+        auto start = std::chrono::steady_clock::now();
+        for (const TransactionPtr & transaction : transactions) {
+            memPool.insert(transaction);
+        }
+        for (const TransactionPtr & transaction : transactions) {
+            memPool.erase(transaction->id);
+        }
+        return elapsed(start);
+    });
+}
+
+/*
+    Block template building as done by Miner::generateBlock: the oldest transactions fitting in a block
+*/
+static Result benchTemplate(size_t n, size_t templates) {
+    std::vector<TransactionPtr> transactions = makeTransactions(n);
+    MemPool memPool;
+    for (const TransactionPtr & transaction : transactions) {
+        memPool.insert(transaction);
+    }
+    return measure("memPool.selectTransactions", n, templates, [&]() {
+        size_t selected = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < templates; i++) {
+            selected += memPool.selectTransactions(MB, 100).size();
+        }
+        double seconds = elapsed(start);
+        sink += selected;
+        return seconds;
+    });
+}
+
+static void fillExponential(CalendarQueue<Event> & queue, size_t n, simTime_t mean, RandomStream & rng) {
+    for (size_t i = 0; i < n; i++) {
+        simTime_t time = getExponentialRandom(rng, mean * n);
+        queue.push(time, Event(EventType::BLOCK_CREATION, BlockPtr(), time, 0));
+    }
+}
+
+/*
+    Classic hold model: the queue keeps n pending events, each pop schedules a new one an exponential delay later
+*/
+static Result benchEventQueue(size_t n, size_t holds) {
+    return measure("calendarQueue.hold", n, holds, [&]() {
+        RandomStream rng(SEED);
+        CalendarQueue<Event> queue(1.0);
+        fillExponential(queue, n, 1.0, rng);
+        simTime_t now = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < holds; i++) {
+            Event event = queue.pop(&now);
+            event.timestamp = now + getExponentialRandom(rng, n);
+            queue.push(event.timestamp, std::move(event));
+        }
+        return elapsed(start);
+    });
+}
+
+static Result benchGraph(int n) {
+    return measure("generate_graph", n, 1, [&]() {
+        RandomStream rng(SEED);
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::vector<int> > graph = generate_graph(n, rng);
+        return elapsed(start);
+    });
+}
+
+/*
+    End-of-run export of every miner's tree, written in parallel to a scratch directory removed afterwards
+*/
+static Result benchExport(const std::string & name, size_t miners, const std::vector<BlockPtr> & blocks, TreeFormat format) {
+    std::vector<BlockTree> trees;
+    for (size_t i = 0; i < miners; i++) {
+        trees.emplace_back(i);
+        MemPool memPool;
+        for (const BlockPtr & block : blocks) {
+            trees.back().addBlock(block, block->timestamp, memPool);
+        }
+    }
+    std::vector<const BlockTree *> pointers;
+    for (const BlockTree & tree : trees) {
+        pointers.push_back(&tree);
+    }
+    std::string directory = (std::filesystem::temp_directory_path() / "sim_bench_trees").string();
+    Result result = measure(name, blocks.size(), miners, [&]() {
+        auto start = std::chrono::steady_clock::now();
+        sink += BlockTree::exportAll(pointers, directory, format);
+        return elapsed(start);
+    });
+    std::filesystem::remove_all(directory);
+    return result;
+}
+
+static void writeJson(std::ostream & out, const std::vector<Result> & results) {
+    out << "{\n  \"seed\": " << SEED << ",\n  \"repeats\": " << REPEATS << ",\n  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result & result = results[i];
+        out << "    {\"name\": \"" << result.name << "\", \"n\": " << result.n << ", \"ops\": " << result.ops
+            << ", \"seconds\": " << result.seconds << ", \"nsPerOp\": " << result.seconds * 1e9 / result.ops << "}"
+            << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    out << "  ]\n}\n";
+}
+
+int main(int argc, char * argv[]) {
+    std::string output = argc > 1 ? argv[1] : "bench.json";
+
+    RandomStream rng(SEED);
+    std::vector<Result> results;
+    results.push_back(benchAddBlock("blockTree.addBlock.linear", buildTree(20000, 1, 1, rng)));
+    results.push_back(benchAddBlock("blockTree.addBlock.forked", buildTree(20000, 64, 1, rng)));
+    results.push_back(benchAddBlock("blockTree.addBlock.reorg", buildRacingBranches(2000)));
+    results.push_back(benchGetUtxos(20000, rng));
+    results.push_back(benchMemPool(100000));
+    results.push_back(benchTemplate(100000, 1000));
+    results.push_back(benchEventQueue(100000, 1000000));
+    std::vector<BlockPtr> exported = buildTree(20000, 64, 1, rng);
+    results.push_back(benchExport("blockTree.exportAll.dot", 16, exported, TreeFormat::DOT));
+    results.push_back(benchExport("blockTree.exportAll.binary", 16, exported, TreeFormat::BINARY));
+    results.push_back(benchFindLCA("blockTree.findLCA.linear", buildTree(20000, 1, 1, rng), 1000000, rng));
+    results.push_back(benchFindLCA("blockTree.findLCA.forked", buildTree(20000, 64, 1, rng), 1000000, rng));
+    // Past the configuration model, the augmentation phase of generate_graph enumerates all O(n^2) vertex pairs;
+    // past 10k nodes it runs out of memory
+    for (int n : {1000, 3000, 10000}) {
+        results.push_back(benchGraph(n));
+    }
+
+    std::ofstream file(output);
+    writeJson(file, results);
+    writeJson(std::cout, results);
+    return 0;
+}
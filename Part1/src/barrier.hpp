@@ -0,0 +1,35 @@
+#ifndef BARRIER_H
+#define BARRIER_H
+
+#include "def.hpp"
+#include <thread>
+
+/*
+    Reusable sense-reversing barrier that spins (then yields) instead of sleeping,
+    synchronisation windows are short and frequent so a futex round trip per window would dominate
+*/
+class SpinBarrier {
+    private:
+        const size_t participants;
+        std::atomic<size_t> waiting;
+        std::atomic<size_t> generation;
+
+    public:
+        SpinBarrier(size_t participants) : participants(participants), waiting(0), generation(0) {}
+
+        void wait() {
+            size_t currentGeneration = generation.load(std::memory_order_acquire);
+            if (waiting.fetch_add(1, std::memory_order_acq_rel) + 1 == participants) {
+                waiting.store(0, std::memory_order_relaxed);
+                generation.fetch_add(1, std::memory_order_acq_rel);
+                return;
+            }
+            for (size_t spins = 0; generation.load(std::memory_order_acquire) == currentGeneration; spins++) {
+                if (spins > 1024) {
+                    std::this_thread::yield();
+                }
+            }
+        }
+};
+
+#endif
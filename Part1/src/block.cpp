@@ -14,6 +14,16 @@ Block::Block(const Block & other) {
     this->parent_id = other.parent_id;
     this->transactions = other.transactions;
     this->timestamp = other.timestamp;
+    this->txnIndex = other.txnIndex;
+}
+
+Block::Block(Block && other) {
+    this->id = other.id;
+    this->height = other.height;
+    this->parent_id = other.parent_id;
+    this->transactions = std::move(other.transactions);
+    this->timestamp = other.timestamp;
+    this->txnIndex = std::move(other.txnIndex);
 }
 
 Block & Block::operator=(const Block & other) {
@@ -22,13 +32,66 @@ Block & Block::operator=(const Block & other) {
     this->parent_id = other.parent_id;
     this->transactions = other.transactions;
     this->timestamp = other.timestamp;
+    this->txnIndex = other.txnIndex;
+    return *this;
+}
+
+Block & Block::operator=(Block && other) {
+    this->id = other.id;
+    this->height = other.height;
+    this->parent_id = other.parent_id;
+    this->transactions = std::move(other.transactions);
+    this->timestamp = other.timestamp;
+    this->txnIndex = std::move(other.txnIndex);
     return *this;
 }
 
+bool Block::operator==(const Block & other) const {
+    return id == other.id;
+}
+
+bool Block::operator!=(const Block & other) const {
+    return !(*this == other);
+}
+
 bool Block::operator < (const Block& other) const {
     return id < other.id;
 }
 
 size_t Block::dataSize() const {
-    return sizeof(Block) + std::accumulate(transactions.begin(), transactions.end(), (size_t) 0, [](int sum, Transaction & txn) { return sum + txn.dataSize(); });
-}
\ No newline at end of file
+    return sizeof(Block) + std::accumulate(transactions.begin(), transactions.end(), (size_t) 0, [](size_t sum, const Transaction & txn) { return sum + txn.dataSize(); });
+}
+
+static size_t txnSlot(txnId_t txnId, size_t mask) {
+    return (txnId * 0x9e3779b97f4a7c15ULL >> 32) & mask;
+}
+
+void Block::buildTxnIndex() {
+    // Keep the load factor at or below one half
+    size_t capacity = 1;
+    while (capacity < 2 * transactions.size()) {
+        capacity <<= 1;
+    }
+    txnIndex.assign(capacity, 0);
+    for (size_t position = 0; position < transactions.size(); position++) {
+        size_t slot = txnSlot(transactions[position].id, capacity - 1);
+        while (txnIndex[slot] != 0) {
+            slot = (slot + 1) & (capacity - 1);
+        }
+        txnIndex[slot] = position + 1;
+    }
+}
+
+const Transaction * Block::findTransaction(txnId_t txnId) const {
+    if (txnIndex.empty()) {
+        return nullptr;
+    }
+    size_t mask = txnIndex.size() - 1;
+    for (size_t slot = txnSlot(txnId, mask); txnIndex[slot] != 0; slot = (slot + 1) & mask) {
+        const Transaction & transaction = transactions[txnIndex[slot] - 1];
+        if (transaction.id == txnId) {
+            return &transaction;
+        }
+    }
+    return nullptr;
+}
@@ -8,20 +8,27 @@ struct Block {
     uint64_t height;
     blockId_t parent_id;
     std::vector<Transaction> transactions;      // Remember to call transactions.shrink_to_fit() after adding all required transactions to reduce block size
-    time_t timestamp;
+    simTime_t timestamp;
+    /*
+        Open addressing table from txnId_t to position in transactions (position + 1, 0 marks an empty slot)
+        Built once by the constructor taking the transactions, call buildTxnIndex() after filling transactions by hand
+    */
+    std::vector<uint32_t> txnIndex;
 
 
     Block();
 
-    Block(blockId_t id, uint64_t height, blockId_t parent_id, std::vector<Transaction> transactions, time_t timestamp):
+    Block(blockId_t id, uint64_t height, blockId_t parent_id, std::vector<Transaction> transactions, simTime_t timestamp):
         id(id),
         height(height),
         parent_id(parent_id),
-        transactions(transactions),
+        transactions(std::move(transactions)),
         timestamp(timestamp)
-    {}
+    {
+        buildTxnIndex();
+    }
 
-    Block(blockId_t id, uint64_t height, blockId_t parent_id, time_t timestamp):
+    Block(blockId_t id, uint64_t height, blockId_t parent_id, simTime_t timestamp):
         id(id),
         height(height),
         parent_id(parent_id),
@@ -30,15 +37,29 @@ struct Block {
 
     Block(const Block & other);
 
+    Block(Block && other);
+
     Block & operator=(const Block & other);
 
-    bool operator==(const Block & other) const; // TODO: implement == operator for block
+    Block & operator=(Block && other);
+
+    bool operator==(const Block & other) const;
 
-    bool operator!=(const Block & other) const; // TODO: implement != operator for block
+    bool operator!=(const Block & other) const;
 
     bool operator < (const Block& other) const;
 
     size_t dataSize() const;
+
+    void buildTxnIndex();
+
+    /*
+        Returns the transaction with the given id in O(1), nullptr if the block does not contain it
+    */
+    const Transaction * findTransaction(txnId_t txnId) const;
 };
 
+// Blocks are immutable once built, everything past the miner that built it shares one copy
+using BlockPtr = std::shared_ptr<const Block>;
+
 #endif
\ No newline at end of file
@@ -0,0 +1,51 @@
+#include "blockStore.hpp"
+
+BlockStore::Shard BlockStore::shards[BlockStore::SHARDS];
+
+BlockStore::Shard & BlockStore::shardOf(blockId_t id) {
+    return shards[id % SHARDS];
+}
+
+static bool sameContent(const Block & a, const Block & b) {
+    if (a.parent_id != b.parent_id || a.timestamp != b.timestamp || a.transactions.size() != b.transactions.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.transactions.size(); i++) {
+        if (a.transactions[i].id != b.transactions[i].id) {
+            return false;
+        }
+    }
+    return true;
+}
+
+BlockPtr BlockStore::intern(BlockPtr block) {
+    Shard & shard = shardOf(block->id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto stored = shard.blocks.emplace(block->id, block);
+    const Block & first = *stored.first->second;
+    if (!stored.second && &first != block.get() && !sameContent(first, *block)) {
+        throw std::logic_error("Block " + std::to_string(block->id) + " reissued with a different body");
+    }
+    return stored.first->second;
+}
+
+BlockPtr BlockStore::find(blockId_t id) {
+    Shard & shard = shardOf(id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto found = shard.blocks.find(id);
+    return found == shard.blocks.end() ? nullptr : found->second;
+}
+
+BlockPtr BlockStore::genesis() {
+    static const BlockPtr block = intern(std::make_shared<const Block>());
+    return block;
+}
+
+size_t BlockStore::size() {
+    size_t count = 0;
+    for (Shard & shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        count += shard.blocks.size();
+    }
+    return count;
+}
@@ -0,0 +1,35 @@
+#ifndef BLOCK_STORE_H
+#define BLOCK_STORE_H
+
+#include "block.hpp"
+
+/*
+    Process-wide store holding the body of every block exactly once
+    1) intern() returns the stored block with the same id, storing the given one if there is none yet, so a block
+       rebuilt with a known id (e.g. when an event is re-executed) collapses onto the first copy; ids cover the
+       block's content (Counter::getBlockID), a different body under a stored id is a bug and throws logic_error
+    2) Stored blocks are never released before the process ends: trees keep plain const Block* into the store and
+       only hold their own metadata (arrival time, height, links, UTXO view); so only blocks some tree accepted are
+       interned, a miner's block template stays its own and is freed once abandoned
+    3) Safe to use from several threads, the index is split in independently locked shards
+*/
+class BlockStore {
+    public:
+        static BlockPtr intern(BlockPtr block);
+        static BlockPtr find(blockId_t id);
+        static BlockPtr genesis();
+        static size_t size();
+
+    private:
+        static const size_t SHARDS = 64;
+
+        struct Shard {
+            std::mutex mutex;
+            std::unordered_map<blockId_t, BlockPtr> blocks;
+        };
+
+        static Shard shards[SHARDS];
+        static Shard & shardOf(blockId_t id);
+};
+
+#endif
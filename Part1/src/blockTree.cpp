@@ -1,386 +1,565 @@
 #include "blockTree.hpp"
-
-BlockTreeNode::BlockTreeNode(Block block, time_t arrivalTime) {
-    this->block = block;
-    this->arrivalTime = arrivalTime;
-    height = 0;
-    parent = nullptr;
-    children = std::vector<BlockTreeNode*>();
+#include "workerPool.hpp"
+#include "metrics.hpp"
+#include "logger.hpp"
+#include "trace.hpp"
+#include <charconv>
+#include <cstdio>
+#include <filesystem>
+
+// Transactions checked per worker pool chunk, blocks smaller than this are validated inline
+static const size_t VALIDATION_GRAIN = 32;
+
+static const char TREE_MAGIC[8] = {'S', 'I', 'M', 'T', 'R', 'E', 'E', 0};
+static const uint32_t TREE_VERSION = 1;
+
+static void appendNumber(std::string & out, uint64_t value) {
+    char buffer[24];
+    out.append(buffer, std::to_chars(buffer, buffer + sizeof(buffer), value).ptr);
 }
 
-BlockTreeNode::BlockTreeNode(const BlockTreeNode & other) {
-    this->block = other.block;
-    this->arrivalTime = other.arrivalTime;
-    this->height = other.height;
-    this->parent = other.parent;
-    this->children = other.children;
+// Same text as the default ostream formatting
+static void appendNumber(std::string & out, double value) {
+    char buffer[32];
+    out.append(buffer, std::snprintf(buffer, sizeof(buffer), "%g", value));
 }
 
-BlockTreeNode & BlockTreeNode::operator=(const BlockTreeNode & other) {
-    this->block = other.block;
-    this->arrivalTime = other.arrivalTime;
-    this->height = other.height;
-    this->parent = other.parent;
-    this->children = other.children;
-    return *this;
+BlockTreeNode::BlockTreeNode(const Block * block, simTime_t arrivalTime, nodeId_t parent, int height) {
+    this->block = block;
+    this->arrivalTime = arrivalTime;
+    this->height = height;
+    this->parent = parent;
+    firstChild = NO_NODE;
+    nextSibling = NO_NODE;
+    ancestorsBegin = 0;
+    ancestorCount = 0;
+    ownedBegin = 0;
+    ownedCount = 0;
+    spentCount = 0;
 }
 
 BlockTree::BlockTree() {
-    genesis = nullptr;
-    current = nullptr;
+    current = NO_NODE;
+    id = 0;
 }
 
-BlockTree::BlockTree(minerId_t id) {
-    genesis = nullptr;
-    current = nullptr;
-    this->id = id;
-}
+BlockTree::BlockTree(minerId_t id) : BlockTree(BlockStore::genesis(), 0, id) {}
 
-BlockTree::BlockTree(const Block & genesisBlock, time_t arrivalTime, minerId_t id) {
-    genesis = new BlockTreeNode(genesisBlock, arrivalTime);
-    current = genesis;
+BlockTree::BlockTree(BlockPtr genesisBlock, simTime_t arrivalTime, minerId_t id) {
+    genesisBlock = BlockStore::intern(std::move(genesisBlock));
+    nodes.emplace_back(genesisBlock.get(), arrivalTime, NO_NODE, 0);
+    current = GENESIS;
+    blockIdToNode[genesisBlock->id] = GENESIS;
     this->id = id;
 }
 
-BlockTree::BlockTree(const BlockTree & other) {
-    genesis = new BlockTreeNode(*other.genesis);
-    current = genesis;
-    this->id = other.id;
+BlockTree::BlockTree(BlockTree && other) noexcept :
+    nodes(std::move(other.nodes)),
+    ancestorArena(std::move(other.ancestorArena)),
+    ownedUtxoArena(std::move(other.ownedUtxoArena)),
+    blockIdToNode(std::move(other.blockIdToNode)),
+    current(other.current),
+    id(other.id),
+    wallet(std::move(other.wallet)),
+    orphans(std::move(other.orphans))
+{
+    other.current = NO_NODE;
 }
 
-BlockTree & BlockTree::operator=(const BlockTree & other) {
+BlockTree & BlockTree::operator=(BlockTree && other) noexcept {
     if (this == &other) {
         return *this;
     }
-    genesis = new BlockTreeNode(*other.genesis);
-    current = genesis;
+    nodes = std::move(other.nodes);
+    ancestorArena = std::move(other.ancestorArena);
+    ownedUtxoArena = std::move(other.ownedUtxoArena);
+    blockIdToNode = std::move(other.blockIdToNode);
+    current = other.current;
+    other.current = NO_NODE;
     this->id = other.id;
+    this->wallet = std::move(other.wallet);
+    this->orphans = std::move(other.orphans);
     return *this;
 }
 
-BlockTree::BlockTree(BlockTree && other) {
-    genesis = other.genesis;
-    current = other.current;
-    other.genesis = nullptr;
-    other.current = nullptr;
-    this->id = other.id;
+const Block * BlockTree::getCurrent() const {
+    return nodes[current].block;
 }
 
-BlockTree & BlockTree::operator=(BlockTree && other) {
-    if (this == &other) {
-        return *this;
-    }
-    genesis = other.genesis;
-    current = other.current;
-    other.genesis = nullptr;
-    other.current = nullptr;
-    this->id = other.id;
-    return *this;
+int BlockTree::getCurrentHeight() const {
+    return nodes[current].height;
 }
 
-BlockTree::~BlockTree() {
-    std::stack<BlockTreeNode*> stack;
-    stack.push(genesis);
-    while (!stack.empty()) {
-        BlockTreeNode* node = stack.top();
-        stack.pop();
-        for (BlockTreeNode* child : node->children) {
-            stack.push(child);
-        }
-        delete node;
+nodeId_t BlockTree::jump(nodeId_t node, size_t k) const {
+    return ancestorArena[nodes[node].ancestorsBegin + k];
+}
+
+void BlockTree::linkAncestors(nodeId_t node) {
+    nodes[node].ancestorsBegin = ancestorArena.size();
+    nodeId_t ancestor = nodes[node].parent;
+    size_t k = 0;
+    for (; ancestor != NO_NODE; k++) {
+        ancestorArena.push_back(ancestor);
+        ancestor = k < nodes[ancestor].ancestorCount ? jump(ancestor, k) : NO_NODE;
     }
+    nodes[node].ancestorCount = k;
 }
 
-Block BlockTree::getCurrent() const {
-    return this->current->block;
+nodeId_t BlockTree::getAncestor(nodeId_t node, int height) const {
+    if (height < 0 || height > nodes[node].height) {
+        return NO_NODE;
+    }
+    int distance = nodes[node].height - height;
+    for (size_t k = 0; distance; k++, distance >>= 1) {
+        if (distance & 1) {
+            node = jump(node, k);
+        }
+    }
+    return node;
 }
 
-int BlockTree::getCurrentHeight() const {
-    return this->current->height;
+bool BlockTree::isAncestor(nodeId_t ancestor, nodeId_t node) const {
+    return this->getAncestor(node, nodes[ancestor].height) == ancestor;
 }
 
-BlockTreeNode* BlockTree::findLCA(BlockTreeNode* node1, BlockTreeNode* node2) const {
-    while (node1 != node2) {
-        if (node1->height > node2->height) {
-            node1 = node1->parent;
-        } else {
-            node2 = node2->parent;
+nodeId_t BlockTree::findLCA(nodeId_t node1, nodeId_t node2) const {
+    if (nodes[node1].height > nodes[node2].height) {
+        node1 = this->getAncestor(node1, nodes[node2].height);
+    } else {
+        node2 = this->getAncestor(node2, nodes[node1].height);
+    }
+    if (node1 == node2) {
+        return node1;
+    }
+    // Both nodes are at the same height: jump as far up as possible while staying below the LCA
+    for (size_t k = nodes[node1].ancestorCount; k-- > 0;) {
+        if (k < nodes[node1].ancestorCount && jump(node1, k) != jump(node2, k)) {
+            node1 = jump(node1, k);
+            node2 = jump(node2, k);
         }
     }
-    return node1;
+    return nodes[node1].parent;
 }
 
 void BlockTree::printTree(std::string filename) const {
     std::ofstream file(filename);
-    if ( ! genesis || ! file.is_open() ) {
+    if ( nodes.empty() || ! file.is_open() ) {
         return;
     }
-    printSubTree(genesis, file);
-    file.close();
+    std::string out;
+    out.reserve(nodes.size() * 32);
+    // Pre-order walk over the child / sibling links: down to the first child, else close nodes up to the first one
+    // having a next sibling
+    nodeId_t node = GENESIS;
+    while ( node != NO_NODE ) {
+        out += "( ";
+        appendNumber(out, nodes[node].block->id);
+        out += ' ';
+        appendNumber(out, nodes[node].arrivalTime);
+        out += '\n';
+        if ( nodes[node].firstChild != NO_NODE ) {
+            node = nodes[node].firstChild;
+            continue;
+        }
+        for ( ; node != NO_NODE; node = nodes[node].parent ) {
+            out += ")\n";
+            if ( nodes[node].nextSibling != NO_NODE ) {
+                node = nodes[node].nextSibling;
+                break;
+            }
+        }
+    }
+    file.write(out.data(), out.size());
 }
 
-void BlockTree::printSubTree(BlockTreeNode* node, std::ofstream & file) const {
-    file << "( " << node->block.id << " " << node->arrivalTime << std::endl;
-    for (BlockTreeNode* child : node->children) {
-        printSubTree(child, file);
+void BlockTree::printChain(nodeId_t node) const {
+    std::string out;
+    for ( ; node != NO_NODE; node = nodes[node].parent ) {
+        appendNumber(out, nodes[node].block->id);
+        out += '\n';
     }
-    file << ")" << std::endl;
+    std::cout << out << std::flush;
 }
 
-void BlockTree::printChain(BlockTreeNode* node) const {
-    while (node) {
-        std::cout << node->block.id << std::endl;
-        node = node->parent;
+BlockTree::TransactionCheck BlockTree::checkTransaction(const Block & block, const Transaction & transaction) const {
+
+    // Every input must name an output stored in the tree
+    uint64_t inputAmount = 0;
+    for ( const Outpoint & input : transaction.inputs() ) {
+        const Utxo * spent = this->findOutput(input);
+        if ( ! spent ) {
+            return TransactionCheck::BAD_INPUT;
+        }
+        inputAmount += spent->amount;
+    }
+
+    // Sum of input utxo amount is not equal to sum of output utxo amount
+    if ( ! transaction.isBalanceConsistent(inputAmount) ) {
+        return TransactionCheck::INCONSISTENT;
     }
+
+    // The outputs must point back at this block and transaction
+    for ( size_t index = 0; index < transaction.outputs().size(); index++ ) {
+        const Utxo & utxo = transaction.outputs()[index];
+        if ( utxo.block != block.id || utxo.txn != transaction.id || utxo.index != index ) {
+            return TransactionCheck::BAD_OUTPUT;
+        }
+    }
+
+    return TransactionCheck::VALID;
 }
 
-bool BlockTree::validateChain(BlockTreeNode* node, std::vector<Utxo *> & utxosUsedByNewNode) const {
+const Utxo * BlockTree::findOutput(const Outpoint & outpoint) const {
+    auto holder = blockIdToNode.find(outpoint.block);
+    if ( holder == blockIdToNode.end() ) {
+        return nullptr;
+    }
+    const Transaction * creator = nodes[holder->second].block->findTransaction(outpoint.txn);
+    if ( ! creator || outpoint.index >= creator->outputs().size() ) {
+        return nullptr;
+    }
+    return &creator->outputs()[outpoint.index];
+}
 
-    // Verifying each transaction
-    for ( Transaction & transaction : node->block.transactions ) {
+bool BlockTree::validateChain(nodeId_t parent, const Block & block, UtxoSet & utxos) const {
 
-        // Sum of input utxo amount is not equal to sum of output utxo amount
-        if ( ! transaction.isBalanceConsistent() ) {
-            std::cout << "The block contains inconsistent transaction\n";
-            return false;
+    // Stateless checks only read the tree and the block, so transactions are spread over the worker pool
+    std::vector<TransactionCheck> checks(block.transactions.size());
+    WorkerPool::shared().parallelFor(block.transactions.size(), VALIDATION_GRAIN, [&](size_t begin, size_t end) {
+        for ( size_t i = begin; i < end; i++ ) {
+            checks[i] = this->checkTransaction(block, block.transactions[i]);
         }
+    });
 
-        // Verifying each input Utxos used in the transaction
-        for ( Utxo & utxo : transaction.in_utxos ) {
+    // Starting from the UTXO view of the parent's chain
+    utxos = nodes[parent].utxos;
 
-            // Block containing the utxo is not in our blockchain
-            if ( blockIdToNode.find(utxo.block) == blockIdToNode.end() ) {
-                std::cout << "The block of the utxo which the new transaction claims to use is not present in our blockchain\n";
-                return false;
-            }
+    // Conflict pass, in block order: every input must still be unspent on this chain
+    for ( size_t i = 0; i < block.transactions.size(); i++ ) {
+        const Transaction & transaction = block.transactions[i];
 
-            // Getting the block object of the utxo
-            Block & prevUtxoBlock = (blockIdToNode.at(utxo.block))->block;
-
-            // Finding the transaction of the utxo
-            Transaction * prevUtxoTransaction = & *std::find_if(prevUtxoBlock.transactions.begin(), prevUtxoBlock.transactions.end(), [&utxo](Transaction & txn) { return txn.id == utxo.txn; });       // TODO: Does this actually capture the transaction stored in the actual blockchain OR points to just a copy
+        switch ( checks[i] ) {
+        case TransactionCheck::VALID:
+            break;
+        case TransactionCheck::INCONSISTENT:
+            SIM_LOG(INFO, INCONSISTENT_TRANSACTION, id, block.id, transaction.id);
+            return false;
+        case TransactionCheck::BAD_INPUT:
+            SIM_LOG(INFO, BAD_INPUT, id, block.id, transaction.id);
+            return false;
+        case TransactionCheck::BAD_OUTPUT:
+            SIM_LOG(INFO, BAD_OUTPUT, id, block.id, transaction.id);
+            return false;
+        }
 
-            // Actually finding the Utxo the node claims to use
-            Utxo * prevUtxo = & prevUtxoTransaction->out_utxos[utxo.index];
+        for ( const Outpoint & input : transaction.inputs() ) {
 
-            // Verify if given utxo object is consistent with the stored utxo object
-            if ( *prevUtxo == utxo ) {
+            // Utxo is not unspent on this chain: never created on it, already spent by an ancestor or earlier in this block
+            if ( ! utxos.contains(input) ) {
+                SIM_LOG(INFO, DOUBLE_SPEND, id, block.id, transaction.id);
                 return false;
             }
+            utxos = utxos.erase(input);
+        }
 
-            // Iterating over all the blocks which are using this utxo and verifying if these are not ancestor of the new node
-            for ( blockId_t & blockConsumingUtxo : prevUtxo->consumedBy ) {
-
-                // Cannot find the block in our blockchain
-                // This also takes care if our block tries to use the same utxo multiple times
-                if ( blockIdToNode.find(blockConsumingUtxo) == blockIdToNode.end() ) {
-                    std::cout << "Something horribly wrong went down\n";
-                    return false;
-                }
-                if ( blockIdToNode.at(blockConsumingUtxo) == this->findLCA(node, blockIdToNode.at(blockConsumingUtxo)) ) {
-                    // Invalid transaction as utxo used by an ancestor                    
-                    return false;
-                }
-            }
-
-            // Registering the new block as one of the consumers of this Utxo
-            prevUtxo->consumedBy.push_back(node->block.id);
-
-            // Bookkeeping for roolback purposes
-            utxosUsedByNewNode.push_back(prevUtxo);
+        for ( const Utxo & utxo : transaction.outputs() ) {
+            utxos = utxos.insert(utxo.outpoint());
         }
     }
+
     return true;
 }
 
-void BlockTree::addNewUnspentUtxos(BlockTreeNode* node) {
-    for ( Transaction & transaction : node->block.transactions ) {
-        for ( Utxo & utxo : transaction.out_utxos ) {
+void BlockTree::computeDelta(nodeId_t node) {
+    BlockTreeNode & entry = nodes[node];
+    entry.ownedBegin = ownedUtxoArena.size();
+    for ( const Transaction & transaction : entry.block->transactions ) {
+        for ( const Utxo & utxo : transaction.outputs() ) {
             if ( utxo.owner == id ) {
-                unspentUtxos.push(utxo);
+                ownedUtxoArena.push_back(utxo);
             }
         }
     }
+    entry.ownedCount = ownedUtxoArena.size() - entry.ownedBegin;
+    // Our own outputs spent by the block follow the outputs paying us
+    for ( const Transaction & transaction : entry.block->transactions ) {
+        for ( const Outpoint & input : transaction.inputs() ) {
+            const Utxo * spent = this->findOutput(input);
+            if ( spent && spent->owner == id ) {
+                ownedUtxoArena.push_back(*spent);
+            }
+        }
+    }
+    entry.spentCount = ownedUtxoArena.size() - entry.ownedBegin - entry.ownedCount;
 }
 
-void BlockTree::updateMemPoolAndBalance(BlockTreeNode* node, std::set<Transaction> & memPool) {
-    BlockTreeNode * node1 = blockIdToNode.at(current->block.id);
-    BlockTreeNode * node2 = blockIdToNode.at(node->block.id);
-
-    std::set<Transaction> memPoolErase;
-    std::set<Transaction> memPoolInsert;
-
-    while ( node1->height > node2->height ) {
-        for (auto txn: node1->block.transactions){
-            memPoolInsert.insert(txn);
+void BlockTree::disconnectBlock(nodeId_t node, MemPool & memPool) {
+    const BlockTreeNode & entry = nodes[node];
+    BlockPtr block = BlockStore::find(entry.block->id);
+    for ( const Transaction & transaction : block->transactions ) {
+        if ( transaction.type != TransactionType::COINBASE ) {
+            // Aliasing handle: shares ownership of the stored block, no transaction copy
+            memPool.insert(TransactionPtr(block, &transaction));
         }
-        node1 = node1->parent;
     }
+    uint32_t spentBegin = entry.ownedBegin + entry.ownedCount;
+    for ( uint32_t i = entry.ownedBegin; i < spentBegin; i++ ) {
+        wallet.remove(ownedUtxoArena[i].outpoint());
+    }
+    for ( uint32_t i = spentBegin; i < spentBegin + entry.spentCount; i++ ) {
+        wallet.unspend(ownedUtxoArena[i]);
+    }
+}
 
-    while ( node2->height > node1->height ) {
-        for (auto txn: node2->block.transactions){
-            memPoolErase.insert(txn);
+void BlockTree::connectBlock(nodeId_t node, MemPool & memPool) {
+    const BlockTreeNode & entry = nodes[node];
+    for ( const Transaction & transaction : entry.block->transactions ) {
+        if ( transaction.type != TransactionType::COINBASE ) {
+            memPool.erase(transaction.id);
+            memPool.removeConflicts(transaction);
         }
-        node2 = node2->parent;
     }
-    
-    while ( node1 != node2 ) {
-        for (auto txn: node1->block.transactions){
-            memPoolInsert.insert(txn);
-        }
-        for (auto txn: node2->block.transactions){
-            memPoolErase.insert(txn);
-        }
-        node1 = node1->parent;
-        node2 = node2->parent;
+    uint32_t spentBegin = entry.ownedBegin + entry.ownedCount;
+    for ( uint32_t i = spentBegin; i < spentBegin + entry.spentCount; i++ ) {
+        wallet.spend(ownedUtxoArena[i].outpoint());
+    }
+    for ( uint32_t i = entry.ownedBegin; i < spentBegin; i++ ) {
+        wallet.add(ownedUtxoArena[i]);
     }
-    
+}
 
-    for (auto txn: memPoolInsert){
-        memPool.insert(txn);
-        for (auto utxo: txn.out_utxos){
-            if (utxo.owner == id){
-                this->balance += utxo.amount;
-            }
-        }
-        for ( auto utxo: txn.in_utxos){
-            if (utxo.owner == id){
-                this->balance -= utxo.amount;
-            }
-        }
+void BlockTree::updateMemPoolAndBalance(nodeId_t node, MemPool & memPool) {
+    nodeId_t fork = this->findLCA(this->current, node);
+
+    // Undo the old branch first so that transactions present on both branches end up out of the mempool
+    uint64_t depth = 0;
+    for ( nodeId_t oldNode = this->current; oldNode != fork; oldNode = nodes[oldNode].parent ) {
+        this->disconnectBlock(oldNode, memPool);
+        depth++;
     }
-    for (auto txn: memPoolErase){
-        memPool.erase(txn);
-        for (auto utxo: txn.out_utxos){
-            if (utxo.owner == id){
-                this->balance -= utxo.amount;
-            }
-        }
-        for ( auto utxo: txn.in_utxos){
-            if (utxo.owner == id){
-                this->balance += utxo.amount;
-            }
+    METRIC_RECORD(REORG_DEPTH, depth);
+    if ( depth > 0 ) {
+        METRIC_COUNT(REORGS);
+        if ( Trace::enabled() ) {
+            Trace::reorg(id, nodes[node].block->id, depth, nodes[node].arrivalTime);
         }
     }
+
+    std::vector<nodeId_t> newBranch;
+    for ( nodeId_t newNode = node; newNode != fork; newNode = nodes[newNode].parent ) {
+        newBranch.push_back(newNode);
+    }
+    for ( auto it = newBranch.rbegin(); it != newBranch.rend(); it++ ) {
+        this->connectBlock(*it, memPool);
+    }
 }
 
-void BlockTree::rollBack(std::vector<Utxo *> & utxosUsedByNewNode) {
-    for ( Utxo * prevAcceptedUtxo : utxosUsedByNewNode ) {
-        prevAcceptedUtxo->consumedBy.pop_back();
+nodeId_t BlockTree::attachBlock(BlockPtr block, simTime_t arrivalTime) {
+
+    // Validating against the parent's chain before anything is stored, rejected blocks never reach the arena
+    nodeId_t parent = blockIdToNode.at(block->parent_id);
+    UtxoSet utxos;
+    bool valid;
+    {
+        METRIC_TIMER(VALIDATE_NANOS);
+        valid = this->validateChain(parent, *block, utxos);
+    }
+    if ( ! valid ) {
+        SIM_LOG(INFO, BLOCK_REJECTED, id, block->id);
+        // Orphans built on top of it can never be connected either
+        orphans.dropDescendants(block->id);
+        return NO_NODE;
     }
+
+    // Appending the tree node of our new block, its body stays in the store
+    block = BlockStore::intern(std::move(block));
+    nodeId_t node = nodes.size();
+    nodes.emplace_back(block.get(), arrivalTime, parent, nodes[parent].height + 1);
+    nodes[node].utxos = std::move(utxos);
+    this->linkAncestors(node);
+    // Undo / redo deltas are computed once here and replayed on every later reorg
+    this->computeDelta(node);
+    // Registering the new node in mappings
+    blockIdToNode[nodes[node].block->id] = node;
+    nodes[node].nextSibling = nodes[parent].firstChild;
+    nodes[parent].firstChild = node;
+    SIM_LOG(INFO, BLOCK_ADDED, id, nodes[node].block->id, nodes[node].height);
+    METRIC_COUNT(BLOCKS_ACCEPTED);
+    if ( Trace::enabled() ) {
+        Trace::blockAccepted(id, *nodes[node].block, arrivalTime);
+    }
+    return node;
 }
 
+int BlockTree::addBlock(BlockPtr block, simTime_t arrivalTime, MemPool & memPool, std::vector<BlockPtr> * adopted) {
 
-int BlockTree::addBlock(const Block block, time_t arrivalTime, std::set<Transaction> & memPool) {
+    // Duplicate block
+    if ( blockIdToNode.count(block->id) ) {
+        return -1;
+    }
 
-    // Making a Tree Node object for our new block
-    BlockTreeNode * blockTreeNode = new BlockTreeNode (block, arrivalTime);
-    BlockTreeNode * parentBlock = blockIdToNode[block.parent_id];
-    blockTreeNode->parent = parentBlock;
-    blockTreeNode->height = parentBlock->height + 1;
-    std::vector<Utxo *> utxosUsedByNewNode;
+    // Parent not yet received, the block waits in the orphan pool until it is
+    if ( ! blockIdToNode.count(block->parent_id) ) {
+        if ( orphans.add(std::move(block), arrivalTime) ) {
+            METRIC_COUNT(ORPHAN_BLOCKS);
+        }
+        return -1;
+    }
 
-    if ( this->validateChain(blockTreeNode, utxosUsedByNewNode) ) {
-        // Adding unspent utxos belonging to the miner to the unspentUtxos queue
-        this->addNewUnspentUtxos(blockTreeNode);
-        // Registering the new node in mappings
-        blockIdToNode[blockTreeNode->block.id] = blockTreeNode;
-        parentBlock->children.push_back(blockTreeNode);
-        std::cout << "Block added succesfully in blockchain!\n";
-    } else {
-        this->rollBack(utxosUsedByNewNode);
-        delete blockTreeNode;
-        std::cout << "Block rejected from blockchain!\n";
+    nodeId_t node = this->attachBlock(std::move(block), arrivalTime);
+    if ( node == NO_NODE ) {
         return -1;
     }
 
-    // Updating current head of blockchain
-    if ( blockTreeNode->height > this->current->height ) {
-        this->updateMemPoolAndBalance(blockTreeNode, memPool);                // New block transactions are not removed here, handled outside
-        this->current = blockTreeNode;
+    // Connecting, level by level, every orphan that was waiting on the new block
+    nodeId_t best = node;
+    std::vector<nodeId_t> connected{node};
+    while ( ! connected.empty() ) {
+        nodeId_t parent = connected.back();
+        connected.pop_back();
+        for ( OrphanPool::Orphan & orphan : orphans.takeChildren(nodes[parent].block->id) ) {
+            nodeId_t child = this->attachBlock(orphan.block, orphan.arrivalTime);
+            if ( child == NO_NODE ) {
+                continue;
+            }
+            METRIC_COUNT(ORPHANS_CONNECTED);
+            if ( adopted ) {
+                adopted->push_back(std::move(orphan.block));
+            }
+            if ( nodes[child].height > nodes[best].height ) {
+                best = child;
+            }
+            connected.push_back(child);
+        }
     }
 
-    return this->current->height;
+    // Updating current head of blockchain once for the whole batch
+    if ( nodes[best].height > nodes[current].height ) {
+        this->updateMemPoolAndBalance(best, memPool);                // New block transactions are not removed here, handled outside
+        this->current = best;
+    }
+    if ( current != best ) {
+        METRIC_COUNT(STALE_BLOCKS);
+    }
+
+    return nodes[current].height;
 }
 
-void BlockTree::exportToDot(const std::string & filename) const {
+bool BlockTree::exportToDot(const std::string & filename) const {
     std::ofstream file(filename);
     if(!file.is_open()){
         std::cerr << "Error opening file: " << filename << std::endl;
-        return;
+        return false;
     }
-    file << "digraph BlockchainTree {\n";
-    file << " node [shape=block];\n";
-
-    std::function<void(BlockTreeNode*)> traverse = [&](BlockTreeNode* node) {
-        if (!node) return;
-
-        file << "    \"" << node->block.id << "\" [label=\"Block " << node->block.id 
-             << "\\nHeight: " << node->height 
-             << "\\nTimestamp: " << node->arrivalTime << "\"];\n";
-
-        for (BlockTreeNode* child : node->children) {
-            file << "    \"" << node->block.id << "\" -> \"" << child->block.id << "\";\n";
-            traverse(child);
+    std::string out = "digraph BlockchainTree {\n node [shape=block];\n";
+    out.reserve(nodes.size() * 96);
+
+    // Parents precede their children in the arena, so one pass in index order declares every block before its edges
+    for ( nodeId_t node = 0; node < nodes.size(); node++ ) {
+        const BlockTreeNode & entry = nodes[node];
+        out += "    \"";
+        appendNumber(out, entry.block->id);
+        out += "\" [label=\"Block ";
+        appendNumber(out, entry.block->id);
+        out += "\\nHeight: ";
+        appendNumber(out, uint64_t(entry.height));
+        out += "\\nTimestamp: ";
+        appendNumber(out, entry.arrivalTime);
+        out += "\"];\n";
+        if ( entry.parent != NO_NODE ) {
+            out += "    \"";
+            appendNumber(out, nodes[entry.parent].block->id);
+            out += "\" -> \"";
+            appendNumber(out, entry.block->id);
+            out += "\";\n";
         }
-    };
-
-    traverse(genesis); // Start from the genesis block
-    file << "}\n";
-    file.close();
-
-    std::cout << "DOT file saved: " << filename << std::endl;
+    }
+    out += "}\n";
+    file.write(out.data(), out.size());
+    return bool(file);
 }
 
-bool BlockTree::verifyUtxo(Utxo & utxo) const {
-    BlockTreeNode * utxoBlock = blockIdToNode.at(utxo.block);
-    Transaction * utxoTransaction = & *std::find_if(utxoBlock->block.transactions.begin(), utxoBlock->block.transactions.end(), [&utxo](Transaction & txn) { return txn.id == utxo.txn; });
-    Utxo * storedUtxo = & utxoTransaction->out_utxos[utxo.index];
-    if ( * storedUtxo != utxo ) {
-        return false;
-    }
-    if ( utxoBlock != this->findLCA(utxoBlock, this->current) ) {
+bool BlockTree::exportToBinary(const std::string & filename) const {
+    std::ofstream file(filename, std::ios::binary);
+    if(!file.is_open()){
+        std::cerr << "Error opening file: " << filename << std::endl;
         return false;
     }
-    for ( auto blockConsumingUtxo : storedUtxo->consumedBy ) {
-        if ( utxoBlock == this->findLCA(utxoBlock, blockIdToNode.at(blockConsumingUtxo)) || blockIdToNode.at(blockConsumingUtxo) == this->findLCA(utxoBlock, blockIdToNode.at(blockConsumingUtxo)) ) {
-            return false;
-        }
+    TreeFileHeader header{};
+    std::copy(TREE_MAGIC, TREE_MAGIC + 8, header.magic);
+    header.version = TREE_VERSION;
+    header.miner = id;
+    header.nodeCount = nodes.size();
+
+    std::vector<uint64_t> blockIds(nodes.size());
+    std::vector<uint32_t> parents(nodes.size());
+    std::vector<uint32_t> heights(nodes.size());
+    std::vector<double> arrivalTimes(nodes.size());
+    for ( nodeId_t node = 0; node < nodes.size(); node++ ) {
+        blockIds[node] = nodes[node].block->id;
+        parents[node] = nodes[node].parent;
+        heights[node] = nodes[node].height;
+        arrivalTimes[node] = nodes[node].arrivalTime;
     }
-    return true;
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(blockIds.data()), blockIds.size() * sizeof(uint64_t));
+    file.write(reinterpret_cast<const char *>(parents.data()), parents.size() * sizeof(uint32_t));
+    file.write(reinterpret_cast<const char *>(heights.data()), heights.size() * sizeof(uint32_t));
+    file.write(reinterpret_cast<const char *>(arrivalTimes.data()), arrivalTimes.size() * sizeof(double));
+    return bool(file);
 }
 
-std::vector<Utxo> BlockTree::getUtxos(int paymentAmount, int & change) {
-    std::vector<Utxo> utxos;
-    if (unspentUtxos.empty()) {
-        return std::vector<Utxo>();
-    }
-    int scannedUtxos = 0;
-    int newBalance = this->balance;
-    while (paymentAmount > 0 && scannedUtxos < unspentUtxos.size()) {
-        if ( verifyUtxo(unspentUtxos.front()) ) {
-            utxos.push_back(unspentUtxos.front());
-            paymentAmount -= unspentUtxos.front().amount;
-            newBalance -= unspentUtxos.front().amount;
-            unspentUtxos.pop();
-        } else {
-            unspentUtxos.push(unspentUtxos.front());
-            unspentUtxos.pop();
-        }
-        scannedUtxos++;
+size_t BlockTree::exportAll(const std::vector<const BlockTree *> & trees, const std::string & directory, TreeFormat format) {
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if ( error ) {
+        std::cerr << "Error creating directory: " << directory << std::endl;
+        return 0;
     }
-    if ( paymentAmount > 0 ) {
-        while ( ! utxos.empty() ) {
-            unspentUtxos.push(utxos.back());
-            utxos.pop_back();
+    std::atomic<size_t> written{0};
+    WorkerPool::shared().parallelFor(trees.size(), 1, [&](size_t begin, size_t end) {
+        for ( size_t i = begin; i < end; i++ ) {
+            std::string path = directory + "/miner_" + std::to_string(trees[i]->id);
+            bool ok = format == TreeFormat::DOT ? trees[i]->exportToDot(path + ".dot") : trees[i]->exportToBinary(path + ".tree");
+            if ( ok ) {
+                written.fetch_add(1, std::memory_order_relaxed);
+            }
         }
-        return std::vector<Utxo>();
-    }
-    this->balance = newBalance;
-    change = - paymentAmount;
+    });
+    return written.load();
+}
+
+std::vector<Utxo> BlockTree::getUtxos(int paymentAmount, int & change) {
+    uint64_t walletChange = 0;
+    std::vector<Utxo> utxos = wallet.select(std::max(paymentAmount, 0), walletChange);
+    change = walletChange;
     return utxos;
 }
 
+void BlockTree::releaseReservations(const MemPool & memPool, const Transaction * scheduled) {
+    const UtxoSet & utxos = nodes[current].utxos;
+    auto isPending = [&memPool, scheduled](const Outpoint & outpoint) {
+        return memPool.spends(outpoint) || ( scheduled &&
+            std::find(scheduled->inputs().begin(), scheduled->inputs().end(), outpoint) != scheduled->inputs().end() );
+    };
+    wallet.release(isPending,
+        [&utxos](const Outpoint & outpoint) { return utxos.contains(outpoint); });
+}
+
 int BlockTree::getBalance() const {
-    return this->balance;
-}
\ No newline at end of file
+    return wallet.getBalance();
+}
+
+bool BlockTree::hasBlock(blockId_t blockId) const {
+    return blockIdToNode.count(blockId) > 0;
+}
+
+bool BlockTree::hasOrphan(blockId_t blockId) const {
+    return orphans.contains(blockId);
+}
+
+bool BlockTree::isSpendable(const Transaction & transaction) const {
+    const UtxoSet & utxos = nodes[current].utxos;
+    return std::all_of(transaction.inputs().begin(), transaction.inputs().end(),
+        [&utxos](const Outpoint & input) { return utxos.contains(input); });
+}
@@ -2,74 +2,184 @@
 #define BLOCKTREE_HPP
 
 #include "block.hpp"
+#include "blockStore.hpp"
 #include "def.hpp"
+#include "utxoSet.hpp"
+#include "memPool.hpp"
+#include "orphanPool.hpp"
+#include "wallet.hpp"
 
+using nodeId_t = uint32_t;      // Index of a node in its tree's node arena
+
+static const nodeId_t NO_NODE = std::numeric_limits<nodeId_t>::max();
+
+/*
+    Formats of a tree export
+    1) DOT: a graphviz digraph, one labelled vertex per block and one edge per parent link
+    2) BINARY: columnar, a TreeFileHeader followed by nodeCount block ids (uint64), parent node indices (uint32,
+       NO_NODE for the genesis), heights (uint32) and arrival times (double); a parent always comes before its children
+*/
+enum class TreeFormat {
+    DOT,
+    BINARY
+};
+
+struct TreeFileHeader {
+    char magic[8];              // "SIMTREE"
+    uint32_t version;
+    uint32_t miner;
+    uint64_t nodeCount;
+};
+
+/*
+    Tree node, stored by value in the node arena of its BlockTree and addressed by its index
+    Links are node ids instead of pointers, so copying or moving a tree keeps all of them valid
+*/
 class BlockTreeNode {
     public:
-        BlockTreeNode(Block block, time_t arrivalTime);
-        BlockTreeNode(const BlockTreeNode & other);
-        BlockTreeNode & operator=(const BlockTreeNode & other);
-        BlockTreeNode* parent;
-        std::vector<BlockTreeNode*> children;
-        Block block;
-        time_t arrivalTime;
+        BlockTreeNode(const Block * block, simTime_t arrivalTime, nodeId_t parent, int height);
+        const Block * block;            // Body held by the BlockStore
+        simTime_t arrivalTime;
         int height;
+        nodeId_t parent;                // NO_NODE for the genesis block
+        nodeId_t firstChild;            // Children are linked through nextSibling, newest first
+        nodeId_t nextSibling;
+        uint32_t ancestorsBegin;        // The 2^k-th ancestor (binary lifting) is the tree's ancestorArena[ancestorsBegin + k]
+        uint8_t ancestorCount;
+        UtxoSet utxos;                  // Outputs left unspent by the chain ending at this block
+        /*
+            Delta applied when the block joins (connect) or leaves (disconnect) the longest chain, computed once on insertion
+            The mempool side is read straight from the block's non-coinbase transactions, the wallet side from the
+            tree's ownedUtxoArena: ownedCount outputs paying the tree's miner from ownedBegin, then spentCount of its
+            outputs spent by the block
+        */
+        uint32_t ownedBegin;
+        uint32_t ownedCount;
+        uint32_t spentCount;
 };
 
 class BlockTree {
+    friend struct BlockTreeBench;       // bench/bench.cpp times the private ancestor queries directly
+
     private:
-        BlockTreeNode* genesis;
-        BlockTreeNode* current; // Points to the bottom of the current longest chain
-        minerId_t id;
-        int balance;
         /*
-            Validates that all transactions in the chain are consistent
+            Node storage
+            1) Every accepted block is appended to nodes, a node id is its index and never changes
+            2) Ancestor tables and owned outputs of all nodes are packed in two flat arenas
+            3) Nothing is allocated per node, so copying a tree is a few vector copies and tearing it down
+               releases the arenas at once instead of walking the tree
         */
-        bool validateChain(BlockTreeNode* node /* The bottom of the chain */, std::vector<Utxo *> & utxosUsedByNewNode) const;
+        std::vector<BlockTreeNode> nodes;
+        std::vector<nodeId_t> ancestorArena;
+        std::vector<Utxo> ownedUtxoArena;
+        std::unordered_map<blockId_t, nodeId_t> blockIdToNode;
 
-        void printSubTree(BlockTreeNode* node, std::ofstream & file) const;
+        nodeId_t current; // Points to the bottom of the current longest chain
+        minerId_t id;
+        Wallet wallet;          // Our coins on the current longest chain, kept in step by connectBlock / disconnectBlock
+        enum class TransactionCheck : uint8_t { VALID, INCONSISTENT, BAD_INPUT, BAD_OUTPUT };
+        /*
+            Checks of a transaction that do not depend on the rest of the block: inputs naming an output stored in the
+            tree, balance against those outputs, outputs pointing back at the block; safe to run concurrently
+        */
+        TransactionCheck checkTransaction(const Block & block, const Transaction & transaction) const;
+        /* The output an input spends, looked up in the block storing it; nullptr if the tree holds no such output */
+        const Utxo * findOutput(const Outpoint & outpoint) const;
+        /*
+            Validates that all transactions of a block extending the chain ending at parent are consistent
+            1) checkTransaction() runs data-parallel over the block's transactions on the shared WorkerPool
+            2) A sequential pass in block order then requires every input to be unspent in the parent's UTXO view
+               (which also catches double spends inside the block), O(inputs) lookups whatever the fork count or
+               chain depth; on success utxos holds the view after applying the block
+        */
+        bool validateChain(nodeId_t parent, const Block & block, UtxoSet & utxos) const;
 
-        std::queue<Utxo> unspentUtxos;
-        bool verifyUtxo(Utxo & utxo) const;
-        BlockTreeNode* findLCA(BlockTreeNode* node1, BlockTreeNode* node2) const;
-        void addNewUnspentUtxos(BlockTreeNode* node);
-        void updateMemPoolAndBalance(BlockTreeNode* node, std::set<Transaction> & memPool);
-        void rollBack(std::vector<Utxo *> & utxosUsedByNewNode);
+        OrphanPool orphans;     // Received blocks whose parent is not in the tree yet
+        /*
+            Ancestor queries over the binary lifting table, all O(log height)
+            isAncestor() is true for the node itself as well
+        */
+        nodeId_t jump(nodeId_t node, size_t k) const;  /* The 2^k-th ancestor of node */
+        nodeId_t findLCA(nodeId_t node1, nodeId_t node2) const;
+        nodeId_t getAncestor(nodeId_t node, int height) const;
+        bool isAncestor(nodeId_t ancestor, nodeId_t node) const;
+        void linkAncestors(nodeId_t node);
+        void computeDelta(nodeId_t node);
+        void connectBlock(nodeId_t node, MemPool & memPool);
+        void disconnectBlock(nodeId_t node, MemPool & memPool);
+        /*
+            Switches the longest chain from current to node: disconnects current's branch down to the fork point
+            and connects node's branch, replaying only the precomputed deltas (O(reorg depth * delta size))
+        */
+        void updateMemPoolAndBalance(nodeId_t node, MemPool & memPool);
+        /*
+            Validates a block whose parent is in the tree and appends it, without moving the longest chain
+            Returns NO_NODE if the block is rejected
+        */
+        nodeId_t attachBlock(BlockPtr block, simTime_t arrivalTime);
 
-        std::unordered_map<blockId_t, BlockTreeNode*> blockIdToNode;
     public:
+        static const nodeId_t GENESIS = 0;
+
         BlockTree();
         BlockTree(minerId_t id);
 
-        BlockTree(const Block & genesisBlock, time_t arrivalTime, minerId_t id);
-        BlockTree(const BlockTree & other);
-        BlockTree & operator=(const BlockTree & other);
-        BlockTree(BlockTree && other);
-        BlockTree & operator=(BlockTree && other);
-        ~BlockTree();
+        BlockTree(BlockPtr genesisBlock, simTime_t arrivalTime, minerId_t id);
+        BlockTree(const BlockTree & other) = default;
+        BlockTree & operator=(const BlockTree & other) = default;
+        BlockTree(BlockTree && other) noexcept;
+        BlockTree & operator=(BlockTree && other) noexcept;
 
-        Block getCurrent() const;
+        const Block * getCurrent() const;
         int getCurrentHeight() const;
         int getBalance() const;
+        bool hasBlock(blockId_t blockId) const;
 
         /*
-            1) Checks if the block can be added to the desired chain (Checks if transactions used are valid)
-            2) Returns -1 if the block cannot be added to the chain
-            3) Returns the height of the chain if the block can be added to the chain
+            1) Checks if the block can be added to the desired chain (Checks if transactions used are valid);
+               an accepted block is interned in the BlockStore, the tree only keeps a pointer to the stored body
+            2) Returns -1 if the block cannot be added to the chain (invalid, duplicate or parent not yet known);
+               a block whose parent is not known yet is kept in the orphan pool instead of being dropped
+            3) Returns the height of the chain if the block can be added to the chain, orphans waiting on it are
+               connected in the same call and appended to adopted (if given) so the caller can relay them
             4) Updates the current chain to the new longest chain
         */
-        int addBlock(const Block block, time_t arrivalTime, std::set<Transaction> & memPool);
+        int addBlock(BlockPtr block, simTime_t arrivalTime, MemPool & memPool, std::vector<BlockPtr> * adopted = nullptr);
+        bool hasOrphan(blockId_t blockId) const;
+        /*
+            True if every input of the transaction is unspent on the current longest chain, i.e. it is neither
+            confirmed already nor double spending a confirmed transaction
+        */
+        bool isSpendable(const Transaction & transaction) const;
 
+        /*
+            Writes the tree as nested "( id arrivalTime" ... ")" groups, children in sibling order
+            Tree walks here and in the exports follow the node links iteratively and build the whole output in memory
+            before a single write, so deep chains cost no stack and no per-line flush
+        */
         void printTree(std::string filename) const;
-        void printChain(BlockTreeNode* node /* The bottom of the chain */) const; /* Prints the chain from the bottom to the genesis */
+        void printChain(nodeId_t node /* The bottom of the chain */) const; /* Prints the chain from the bottom to the genesis */
 
 
         /*
-            Returns a vector of utxos that can be used to pay for a transaction of the desired amount
+            Returns a vector of utxos that can be used to pay for a transaction of the desired amount, picked from the
+            wallet (best fit, reserved from now on)
             If the amount is not possible to pay for with the current utxos, returns an empty vector
         */
         std::vector<Utxo> getUtxos(int paymentAmount, int & change);
-        void exportToDot(const std::string & filename) const;
+        /*
+            Hands the reserved coins of transactions that left the mempool unconfirmed back to the wallet
+            Call once the chain changed and every transaction still pending is back in memPool, except our own one
+            created but not broadcast yet (scheduled, may be nullptr)
+        */
+        void releaseReservations(const MemPool & memPool, const Transaction * scheduled);
+        bool exportToDot(const std::string & filename) const;
+        bool exportToBinary(const std::string & filename) const;
+        /*
+            Exports every tree to directory/miner_<id>.dot (or .tree in BINARY format), created if needed
+            Trees are written concurrently on the shared WorkerPool; returns the number of files written
+        */
+        static size_t exportAll(const std::vector<const BlockTree *> & trees, const std::string & directory, TreeFormat format);
 
 };
 
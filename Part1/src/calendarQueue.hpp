@@ -0,0 +1,200 @@
+#ifndef CALENDAR_QUEUE_H
+#define CALENDAR_QUEUE_H
+
+#include "def.hpp"
+#include <optional>
+
+/*
+    Calendar queue (R. Brown, 1988) keyed on simulated time
+    1) Time is split into "days" of fixed width, day i of every "year" goes into bucket i % numBuckets
+    2) Each bucket is kept sorted, so dequeueing scans at most one year of buckets (amortised O(1))
+    3) Bucket count doubles / halves with the queue size and the day width is re-estimated from
+       the spacing of the earliest pending entries
+    4) Ties on time are broken by insertion order, so equal timestamps are processed FIFO
+    Items live in a slot pool and buckets only move (time, seq, slot) keys around
+*/
+template <typename T>
+class CalendarQueue {
+    private:
+        struct Key {
+            simTime_t time;
+            uint64_t seq;
+            uint32_t slot;
+            bool operator > (const Key & other) const {
+                return time > other.time || (time == other.time && seq > other.seq);
+            }
+        };
+
+        static constexpr size_t MIN_BUCKETS = 16;
+        static constexpr size_t WIDTH_SAMPLES = 25;
+
+        std::vector<std::vector<Key>> buckets;     // Each bucket sorted in decreasing order, minimum at back()
+        std::vector<std::optional<T>> slots;
+        std::vector<uint32_t> freeSlots;
+        size_t count;
+        double width;
+        size_t lastBucket;
+        double bucketTop;                           // Upper time bound of lastBucket in the current year
+        simTime_t lastTime;
+        uint64_t nextSeq;
+
+        size_t bucketOf(simTime_t time) const {
+            return (size_t) std::fmod(std::floor(time / width), (double) buckets.size());
+        }
+
+        void moveTo(simTime_t time) {
+            lastTime = time;
+            lastBucket = bucketOf(time);
+            bucketTop = (std::floor(time / width) + 1) * width;
+        }
+
+        void insertKey(const Key & key) {
+            std::vector<Key> & bucket = buckets[bucketOf(key.time)];
+            bucket.insert(std::upper_bound(bucket.begin(), bucket.end(), key, [](const Key & a, const Key & b) { return a > b; }), key);
+        }
+
+        double estimateWidth() const {
+            std::vector<simTime_t> times;
+            times.reserve(count);
+            for (const auto & bucket : buckets) {
+                for (const Key & key : bucket) {
+                    times.push_back(key.time);
+                }
+            }
+            size_t samples = std::min(times.size(), WIDTH_SAMPLES);
+            if (samples < 2) {
+                return width;
+            }
+            std::partial_sort(times.begin(), times.begin() + samples, times.end());
+            double average = (times[samples - 1] - times[0]) / (samples - 1);
+            // Ignore the outlying gaps so that one straggler does not blow up the day width
+            double total = 0;
+            size_t gaps = 0;
+            for (size_t i = 1; i < samples; i++) {
+                double gap = times[i] - times[i - 1];
+                if (gap <= 2 * average) {
+                    total += gap;
+                    gaps++;
+                }
+            }
+            double separation = gaps ? total / gaps : average;
+            return separation > 0 ? 3 * separation : width;
+        }
+
+        void resize(size_t numBuckets) {
+            double newWidth = estimateWidth();
+            std::vector<std::vector<Key>> old;
+            old.swap(buckets);
+            buckets.assign(numBuckets, std::vector<Key>());
+            width = newWidth;
+            for (const auto & bucket : old) {
+                for (const Key & key : bucket) {
+                    insertKey(key);
+                }
+            }
+            moveTo(lastTime);
+        }
+
+        T take(std::vector<Key> & bucket, simTime_t * time) {
+            Key key = bucket.back();
+            bucket.pop_back();
+            count--;
+            moveTo(key.time);
+            T item = std::move(*slots[key.slot]);
+            slots[key.slot].reset();
+            freeSlots.push_back(key.slot);
+            if (count < buckets.size() / 2 && buckets.size() > MIN_BUCKETS) {
+                resize(buckets.size() / 2);
+            }
+            if (time) {
+                *time = key.time;
+            }
+            return item;
+        }
+
+    public:
+        CalendarQueue(double width = 1.0):
+            buckets(MIN_BUCKETS),
+            count(0),
+            width(width),
+            lastBucket(0),
+            bucketTop(width),
+            lastTime(0),
+            nextSeq(0)
+        {}
+
+        bool empty() const {
+            return count == 0;
+        }
+
+        size_t size() const {
+            return count;
+        }
+
+        void push(simTime_t time, T item) {
+            uint32_t slot;
+            if (freeSlots.empty()) {
+                slot = slots.size();
+                slots.emplace_back(std::move(item));
+            } else {
+                slot = freeSlots.back();
+                freeSlots.pop_back();
+                slots[slot].emplace(std::move(item));
+            }
+            insertKey(Key{time, nextSeq++, slot});
+            count++;
+            if (time < lastTime) {
+                moveTo(time);
+            }
+            if (count > 2 * buckets.size()) {
+                resize(2 * buckets.size());
+            }
+        }
+
+        /*
+            Removes and returns the earliest item, its time is written to *time when given
+            Must not be called on an empty queue
+        */
+        T pop(simTime_t * time = nullptr) {
+            size_t i = lastBucket;
+            double top = bucketTop;
+            for (size_t scanned = 0; scanned < buckets.size(); scanned++) {
+                if (!buckets[i].empty() && buckets[i].back().time < top) {
+                    return take(buckets[i], time);
+                }
+                i = (i + 1) % buckets.size();
+                top += width;
+            }
+            // Nothing due in the coming year, fall back to a direct search for the minimum
+            std::vector<Key> * earliest = nullptr;
+            for (auto & bucket : buckets) {
+                if (!bucket.empty() && (!earliest || earliest->back() > bucket.back())) {
+                    earliest = &bucket;
+                }
+            }
+            return take(*earliest, time);
+        }
+
+        simTime_t topTime() {
+            simTime_t time = lastTime;
+            size_t i = lastBucket;
+            double top = bucketTop;
+            for (size_t scanned = 0; scanned < buckets.size(); scanned++) {
+                if (!buckets[i].empty() && buckets[i].back().time < top) {
+                    return buckets[i].back().time;
+                }
+                i = (i + 1) % buckets.size();
+                top += width;
+            }
+            bool found = false;
+            for (auto & bucket : buckets) {
+                if (!bucket.empty() && (!found || bucket.back().time < time)) {
+                    time = bucket.back().time;
+                    found = true;
+                }
+            }
+            return time;
+        }
+};
+
+#endif
@@ -8,6 +8,7 @@
 #include <fstream>
 #include <stack>
 #include <set>
+#include <map>
 #include <unordered_map>
 #include <algorithm>
 #include <numeric>
@@ -15,14 +16,48 @@
 #include <algorithm>
 #include <random>
 #include <queue>
+#include <functional>
+#include <chrono>
+#include <cstdint>
+#include <cmath>
+#include <memory>
+#include <atomic>
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <tuple>
+#include <type_traits>
+#include <stdexcept>
+#include <cassert>
 
 using txnId_t = uint64_t;
 using minerId_t = uint64_t;
 using blockId_t = uint64_t;
+using simTime_t = double;          // Simulated time in seconds
 
 const int MB = 1000000;
 const double BLOCK_INTER_ARRIVAL_TIME = 600;
 const uint64_t MINING_REWARD = 50;
 const double TXN_INTER_ARRIVAL_TIME = 60;  //TODO: Take this as command line argument
 const int NUM_MINERS = 10;
+const size_t MAX_PEERS = 64;                // Neighbours of a miner, bounded by the multicast peer set (Event::peers)
+const size_t MAX_ORPHAN_BLOCKS = 256;       // Blocks a tree buffers while their parent is missing
+const size_t SEEN_BLOCKS_CAPACITY = 1024;   // Gossip dedup keys a miner remembers at least (ids seen, peers known to have them)
+const size_t SEEN_TXNS_CAPACITY = 8192;
+const int ID_SEQUENCE_BITS = 40;            // Low bits of a block / transaction id, the creating miner's id sits above them
+const size_t MAX_TXN_INPUTS = 4;            // Coins one transaction may spend, held inline (Transaction::inputSlots)
+const size_t MAX_TXN_OUTPUTS = 2;           // Payment and change
+
+// Network model (CS765 HW1): latency of a message of m bits on link i->j is rho_ij + m / c_ij + d_ij
+const double MIN_PROPAGATION_DELAY = 0.01;     // rho_ij ~ U[10 ms, 500 ms], drawn once per link
+const double MAX_PROPAGATION_DELAY = 0.5;
+const double SLOW_NODE_FRACTION = 0.5;
+const double FAST_LINK_BANDWIDTH = 100e6;      // c_ij in bits/s, fast only if both ends are fast nodes
+const double SLOW_LINK_BANDWIDTH = 5e6;
+const double QUEUEING_DELAY_BITS = 96e3;       // d_ij ~ Exp(mean QUEUEING_DELAY_BITS / c_ij), drawn per message
+
+// Wire sizes of the compact relay messages (BIP 152 style)
+const uint32_t HEADER_BYTES = 80;
+const uint32_t INV_BYTES = 36;                 // A request naming a block (getdata / getblocktxn)
+const uint32_t SHORT_TXN_ID_BYTES = 6;
 #endif
\ No newline at end of file
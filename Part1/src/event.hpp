@@ -12,73 +12,123 @@ enum class EventType {
     BROADCAST_BLOCK,
     BROADCAST_TRANSACTION,
     SEND_BROADCAST_BLOCK,
-    SEND_BROADCAST_TRANSACTION
+    SEND_BROADCAST_TRANSACTION,
+    // Compact relay: header announcement, compact block request / reply, missing transactions request / reply
+    SEND_BLOCK_HEADER,
+    RECEIVE_BLOCK_HEADER,
+    SEND_GET_COMPACT_BLOCK,
+    RECEIVE_GET_COMPACT_BLOCK,
+    SEND_COMPACT_BLOCK,
+    RECEIVE_COMPACT_BLOCK,
+    SEND_GET_BLOCK_TXNS,
+    RECEIVE_GET_BLOCK_TXNS,
+    SEND_BLOCK_TXNS,
+    RECEIVE_BLOCK_TXNS
 };
 
+/*
+    Events only carry shared handles to the (immutable) block or transaction they are about,
+    so fanning one block out to every peer copies a pointer per peer and never the payload.
+    Events are move-only: hand them over with std::move instead of copying them.
+    A SEND_* event with a non-empty peers set is a multicast: one event for all the listed neighbours of owner.
+    The scheduler routes it when the miner returns it: every link is reserved at once, in neighbour order, and the
+    event becomes the delivery to the earliest peer, the later ones kept in arrivals. It takes a single queue entry:
+    each time it is popped the scheduler splits off the rest with nextDelivery() and requeues it at the next arrival.
+*/
 struct Event {
     EventType type;
-    Block * block;
-    Transaction * transaction;
-    time_t timestamp;       // Time when this event will be processed
-    minerId_t owner;
+    uint32_t payloadSize;   // Bytes carried (or asked for) by a compact relay message, the block's own size is not used
+    BlockPtr block;
+    TransactionPtr transaction;
+    simTime_t timestamp;    // Time when this event will be processed
+    minerId_t owner;        // Miner which generated this event (the sender for RECEIVE_* events)
+    minerId_t receiver;     // Miner on which this event is processed (the peer for SEND_* events)
+    uint64_t peers;         // Multicast: bit i set for the owner's i-th neighbour, 0 for a single receiver
 
-    Event(EventType type, const Block*  block, time_t timestamp, minerId_t owner):
+    struct Arrival {
+        simTime_t time;
+        minerId_t receiver;
+    };
+    std::vector<Arrival> arrivals;      // Routed multicast: deliveries after this one, latest first
+
+    Event(EventType type, BlockPtr block, simTime_t timestamp, minerId_t owner):
+        Event(type, std::move(block), timestamp, owner, owner)
+    {}
+
+    Event(EventType type, TransactionPtr transaction, simTime_t timestamp, minerId_t owner):
+        Event(type, std::move(transaction), timestamp, owner, owner)
+    {}
+
+    Event(EventType type, BlockPtr block, simTime_t timestamp, minerId_t owner, minerId_t receiver):
         type(type),
+        payloadSize(0),
+        block(std::move(block)),
         transaction(nullptr),
         timestamp(timestamp),
-        owner(owner)
-    {
-        this->block = new Block(*block);
-    }
+        owner(owner),
+        receiver(receiver),
+        peers(0)
+    {}
 
-    Event(EventType type, const Transaction*  transaction, time_t timestamp, minerId_t owner):
+    Event(EventType type, TransactionPtr transaction, simTime_t timestamp, minerId_t owner, minerId_t receiver):
         type(type),
+        payloadSize(0),
         block(nullptr),
+        transaction(std::move(transaction)),
         timestamp(timestamp),
-        owner(owner)
-    {
-        this->transaction = new Transaction(*transaction);
+        owner(owner),
+        receiver(receiver),
+        peers(0)
+    {}
+
+    /*
+        Delivery of this (multicast) event to one peer, sharing its payload
+    */
+    Event forPeer(minerId_t peer) const {
+        Event delivery = block ? Event(type, block, timestamp, owner, peer) : Event(type, transaction, timestamp, owner, peer);
+        delivery.payloadSize = payloadSize;
+        return delivery;
     }
 
-    Event(const Event & other) {
-        type = other.type;
-        timestamp = other.timestamp;
-        owner = other.owner;
-        if (other.block != nullptr) {
-            block = new Block(*other.block);
-            transaction = nullptr;
-        } else {
-            transaction = new Transaction(*other.transaction);
-            block = nullptr;
-        }
-    };
+    /*
+        Makes this event the earliest of the given deliveries (sorted latest first) and keeps the others
+    */
+    void setArrivals(std::vector<Arrival> && latestFirst) {
+        timestamp = latestFirst.back().time;
+        receiver = latestFirst.back().receiver;
+        latestFirst.pop_back();
+        arrivals = std::move(latestFirst);
+    }
 
-    Event & operator = (const Event & other) {
-        if (this == &other) {
-            return *this;
-        }
-        type = other.type;
-        timestamp = other.timestamp;
-        owner = other.owner;
-        if (other.block != nullptr) {
-            block = new Block(*other.block);
-            transaction = nullptr;
-        } else {
-            transaction = new Transaction(*other.transaction);
-            block = nullptr;
-        }
-        return *this;
+    /*
+        Every delivery of a routed multicast, this event's own included, latest first; leaves no arrivals behind
+    */
+    std::vector<Arrival> takeArrivals() {
+        std::vector<Arrival> all = std::move(arrivals);
+        arrivals.clear();
+        all.push_back(Arrival{timestamp, receiver});
+        return all;
     }
 
-    bool operator < (const Event& other) const {
-        return timestamp < other.timestamp;
+    /*
+        Splits the deliveries after this one off a routed multicast, into an event due at the next arrival
+        This event is left a plain delivery to its receiver
+    */
+    Event nextDelivery() {
+        Event rest = forPeer(receiver);
+        rest.setArrivals(std::move(arrivals));
+        arrivals.clear();
+        return rest;
     }
 
-    ~Event() {
-        delete block;
-        delete transaction;
+    Event(const Event & other) = delete;
+    Event & operator = (const Event & other) = delete;
+    Event(Event && other) = default;
+    Event & operator = (Event && other) = default;
+
+    bool operator < (const Event& other) const {
+        return timestamp < other.timestamp;
     }
-    
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,164 @@
+#include "logger.hpp"
+#include "speculation.hpp"
+#include <thread>
+#include <condition_variable>
+#include <cstdio>
+
+namespace {
+
+    const size_t RING_CAPACITY = 1 << 13;     // Records per thread, a power of two
+
+    const char * LEVEL_NAMES[] = {"DEBUG", "INFO", "WARN", "ERROR", "OFF"};
+
+    struct MessageFormat {
+        const char * name;
+        const char * args[3];
+    };
+
+    const MessageFormat FORMATS[] = {
+        {"block_added", {"miner", "block", "height"}},
+        {"block_rejected", {"miner", "block", nullptr}},
+        {"inconsistent_transaction", {"miner", "block", "txn"}},
+        {"bad_input", {"miner", "block", "txn"}},
+        {"bad_output", {"miner", "block", "txn"}},
+        {"double_spend", {"miner", "block", "txn"}}
+    };
+
+    static_assert(sizeof(FORMATS) / sizeof(*FORMATS) == static_cast<size_t>(LogMessage::COUNT), "One format per log message");
+
+    /*
+        Single producer (the owning thread), single consumer (the writer)
+    */
+    struct Ring {
+        alignas(64) std::atomic<uint64_t> head{0};     // Next record to read
+        alignas(64) std::atomic<uint64_t> tail{0};     // Next record to write
+        uint64_t dropped = 0;                           // Written by the producer only
+        uint32_t thread;
+        Logger::Record records[RING_CAPACITY];
+    };
+
+    std::mutex registryMutex;
+    std::vector<std::unique_ptr<Ring>> registry;
+
+    std::thread writer;
+    std::mutex writerMutex;
+    std::condition_variable writerWake;
+    bool writerStopping = false;
+    FILE * output = nullptr;
+
+    Ring & localRing() {
+        thread_local Ring * ring = nullptr;
+        if (!ring) {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            registry.push_back(std::make_unique<Ring>());
+            ring = registry.back().get();
+            ring->thread = registry.size() - 1;
+        }
+        return *ring;
+    }
+
+    void writeRecord(const Logger::Record & record) {
+        const MessageFormat & format = FORMATS[static_cast<size_t>(record.message)];
+        fprintf(output, "{\"ns\": %llu, \"level\": \"%s\", \"thread\": %u, \"event\": \"%s\"", (unsigned long long) record.wallNanos,
+                LEVEL_NAMES[static_cast<size_t>(record.level)], record.thread, format.name);
+        for (size_t i = 0; i < 3 && format.args[i]; i++) {
+            fprintf(output, ", \"%s\": %llu", format.args[i], (unsigned long long) record.args[i]);
+        }
+        fputs("}\n", output);
+    }
+
+    /*
+        Writes every record published so far, returns whether there was any
+    */
+    bool drain() {
+        std::vector<Ring *> rings;
+        {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            for (const std::unique_ptr<Ring> & ring : registry) {
+                rings.push_back(ring.get());
+            }
+        }
+        bool wrote = false;
+        for (Ring * ring : rings) {
+            uint64_t head = ring->head.load(std::memory_order_relaxed);
+            uint64_t tail = ring->tail.load(std::memory_order_acquire);
+            for (; head != tail; head++) {
+                writeRecord(ring->records[head & (RING_CAPACITY - 1)]);
+                wrote = true;
+            }
+            ring->head.store(head, std::memory_order_release);
+        }
+        return wrote;
+    }
+}
+
+std::atomic<bool> Logger::running{false};
+
+void Logger::start(const std::string & path) {
+    output = path == "-" ? stderr : fopen(path.c_str(), "w");
+    if (!output) {
+        std::cerr << "Error opening log file: " << path << std::endl;
+        return;
+    }
+    writerStopping = false;
+    writer = std::thread([]() {
+        std::unique_lock<std::mutex> lock(writerMutex);
+        while (!writerStopping) {
+            lock.unlock();
+            bool wrote = drain();
+            lock.lock();
+            if (!wrote) {
+                writerWake.wait_for(lock, std::chrono::milliseconds(1));
+            }
+        }
+    });
+    running.store(true, std::memory_order_release);
+}
+
+void Logger::stop() {
+    if (!writer.joinable()) {
+        return;
+    }
+    running.store(false, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lock(writerMutex);
+        writerStopping = true;
+    }
+    writerWake.notify_all();
+    writer.join();
+    drain();
+
+    uint64_t dropped = 0;
+    for (const std::unique_ptr<Ring> & ring : registry) {
+        dropped += ring->dropped;
+    }
+    if (dropped > 0) {
+        fprintf(output, "{\"level\": \"WARN\", \"event\": \"log_records_dropped\", \"count\": %llu}\n", (unsigned long long) dropped);
+    }
+    if (output != stderr) {
+        fclose(output);
+    }
+    fflush(stderr);
+    output = nullptr;
+}
+
+void Logger::log(LogLevel level, LogMessage message, uint64_t arg0, uint64_t arg1, uint64_t arg2) {
+    if (Speculation::capture([=] { log(level, message, arg0, arg1, arg2); })) {
+        return;
+    }
+    Ring & ring = localRing();
+    uint64_t tail = ring.tail.load(std::memory_order_relaxed);
+    if (tail - ring.head.load(std::memory_order_acquire) == RING_CAPACITY) {
+        ring.dropped++;
+        return;
+    }
+    Record & record = ring.records[tail & (RING_CAPACITY - 1)];
+    record.wallNanos = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    record.thread = ring.thread;
+    record.level = level;
+    record.message = message;
+    record.args[0] = arg0;
+    record.args[1] = arg1;
+    record.args[2] = arg2;
+    ring.tail.store(tail + 1, std::memory_order_release);
+}
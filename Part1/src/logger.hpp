@@ -0,0 +1,74 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include "def.hpp"
+
+enum class LogLevel : uint8_t {
+    DEBUG,
+    INFO,
+    WARN,
+    ERROR,
+    OFF
+};
+
+// Records below this level are compiled out (make LOG_LEVEL=DEBUG ... OFF)
+#ifndef SIM_LOG_LEVEL
+#define SIM_LOG_LEVEL INFO
+#endif
+static constexpr LogLevel COMPILED_LOG_LEVEL = LogLevel::SIM_LOG_LEVEL;
+
+/*
+    Messages are ids into a table of names and argument names, formatted by the writer thread only
+*/
+enum class LogMessage : uint16_t {
+    BLOCK_ADDED,                // miner, block, height
+    BLOCK_REJECTED,             // miner, block
+    INCONSISTENT_TRANSACTION,   // miner, block, txn: outputs do not add up to the spent inputs (or the reward)
+    BAD_INPUT,                  // miner, block, txn: an input names no output stored in the tree
+    BAD_OUTPUT,                 // miner, block, txn: an output does not point back at its block and transaction
+    DOUBLE_SPEND,               // miner, block, txn: an input already spent on the chain or earlier in the block
+    COUNT
+};
+
+/*
+    Asynchronous structured logger
+    1) A log call copies a fixed-size record (message id and up to three integer arguments, no formatting) into
+       the calling thread's single-producer ring; a full ring drops the record and counts it, the caller never waits
+    2) A background writer drains every ring and writes one JSON object per line
+    3) Nothing is recorded before start() or after stop(), and levels below SIM_LOG_LEVEL never reach a call
+    4) Records of speculative events are only written once the event commits (speculation.hpp)
+*/
+class Logger {
+    public:
+        struct Record {
+            uint64_t wallNanos;
+            uint32_t thread;
+            LogLevel level;
+            LogMessage message;
+            uint64_t args[3];
+        };
+
+        /*
+            path "-" writes to stderr
+        */
+        static void start(const std::string & path);
+        static void stop();
+
+        static bool enabled() {
+            return running.load(std::memory_order_relaxed);
+        }
+
+        static void log(LogLevel level, LogMessage message, uint64_t arg0 = 0, uint64_t arg1 = 0, uint64_t arg2 = 0);
+
+    private:
+        static std::atomic<bool> running;
+};
+
+#define SIM_LOG(level, message, ...) \
+    do { \
+        if (LogLevel::level >= COMPILED_LOG_LEVEL && Logger::enabled()) { \
+            Logger::log(LogLevel::level, LogMessage::message, ##__VA_ARGS__); \
+        } \
+    } while (0)
+
+#endif
@@ -1,6 +1,91 @@
-#include "miner.hpp"
+#include "parallelScheduler.hpp"
+#include "timeWarpScheduler.hpp"
+#include "logger.hpp"
+#include "trace.hpp"
 
-int main() {
-    
+int main(int argc, char * argv[]) {
+    int numMiners = argc > 1 ? std::stoi(argv[1]) : NUM_MINERS;
+    simTime_t endTime = argc > 2 ? std::stod(argv[2]) : 24 * 60 * 60;
+    uint64_t seed = argc > 3 ? std::stoull(argv[3]) : 1;
+    size_t numThreads = argc > 4 ? std::stoul(argv[4]) : 1;
+    std::string synchronisation = argc > 5 ? argv[5] : "conservative";
+    if (synchronisation != "conservative" && synchronisation != "optimistic") {
+        std::cerr << "Unknown synchronisation " << synchronisation << ", expected conservative or optimistic" << std::endl;
+        return 1;
+    }
+    std::string relay = argc > 6 ? argv[6] : "full";
+    if (relay != "full" && relay != "compact") {
+        std::cerr << "Unknown relay " << relay << ", expected full or compact" << std::endl;
+        return 1;
+    }
+    RelayMode relayMode = relay == "compact" ? RelayMode::COMPACT : RelayMode::FULL;
+    std::string metricsPath = argc > 7 ? argv[7] : "";
+    double metricsInterval = argc > 8 ? std::stod(argv[8]) : 0;
+    std::string logPath = argc > 9 ? argv[9] : "";
+    std::string tracePath = argc > 10 ? argv[10] : "";
+    std::string treeDirectory = argc > 11 ? argv[11] : "";
+    std::string treeFormat = argc > 12 ? argv[12] : "dot";
+    if (treeFormat != "dot" && treeFormat != "binary") {
+        std::cerr << "Unknown tree format " << treeFormat << ", expected dot or binary" << std::endl;
+        return 1;
+    }
+
+    // Every random stream of the run is split off this one, in a fixed order
+    RandomStream master(seed);
+    RandomStream graphRng = master.split();
+    RandomStream networkRng = master.split();
+
+    std::vector<std::vector<int> > graph = generate_graph(numMiners, graphRng);
+
+    std::vector<Miner> miners;
+    miners.reserve(numMiners);
+    for (int i = 0; i < numMiners; i++) {
+        miners.emplace_back(i, 1.0 / numMiners, std::vector<minerId_t>(graph[i].begin(), graph[i].end()), master.split(), numMiners, relayMode);
+    }
+
+    std::unique_ptr<Scheduler> scheduler;
+    TimeWarpScheduler * timeWarp = nullptr;
+    if (synchronisation == "optimistic") {
+        scheduler = std::make_unique<TimeWarpScheduler>(miners, networkRng, numThreads);
+        timeWarp = static_cast<TimeWarpScheduler*>(scheduler.get());
+    } else if (numThreads > 1) {
+        scheduler = std::make_unique<ParallelScheduler>(miners, networkRng, numThreads);
+    } else {
+        scheduler = std::make_unique<SequentialScheduler>(miners, networkRng);
+    }
+    if (!logPath.empty()) {
+        Logger::start(logPath);
+    }
+    if (!tracePath.empty() && !Trace::start(tracePath)) {
+        return 1;
+    }
+    if (!metricsPath.empty()) {
+        Metrics::startReporter(metricsPath, metricsInterval);
+    }
+    scheduler->run(endTime);
+    Metrics::stopReporter();
+    Logger::stop();
+    Trace::stop();
+
+    std::cout << "Simulated " << scheduler->getTime() << "s with " << numMiners << " miners" << std::endl;
+    for (const Miner & miner : miners) {
+        std::cout << "Miner " << miner.getId() << ": height " << miner.getBlockTree().getCurrentHeight()
+                  << ", balance " << miner.getBlockTree().getBalance() << std::endl;
+    }
+    std::cout << "Processed " << scheduler->getProcessedEvents() << " events in " << scheduler->getWallSeconds()
+              << "s (" << scheduler->getEventsPerSecond() << " events/sec)" << std::endl;
+    if (!treeDirectory.empty()) {
+        std::vector<const BlockTree *> trees;
+        for (const Miner & miner : miners) {
+            trees.push_back(&miner.getBlockTree());
+        }
+        auto start = std::chrono::steady_clock::now();
+        size_t written = BlockTree::exportAll(trees, treeDirectory, treeFormat == "binary" ? TreeFormat::BINARY : TreeFormat::DOT);
+        std::cout << "Exported " << written << " block trees to " << treeDirectory << " in "
+                  << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() << "s" << std::endl;
+    }
+    if (timeWarp) {
+        std::cout << "Rolled back " << timeWarp->getRolledBackEvents() << " speculative events" << std::endl;
+    }
     return 0;
 }
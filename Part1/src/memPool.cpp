@@ -0,0 +1,86 @@
+#include "memPool.hpp"
+
+MemPool::MemPool() : totalSize(0), arrivals(0) {}
+
+bool MemPool::insert(TransactionPtr transaction) {
+    if (byId.count(transaction->id)) {
+        return false;
+    }
+    for (const Outpoint & input : transaction->inputs()) {
+        if (bySpentOutpoint.count(input)) {
+            return false;
+        }
+    }
+    for (const Outpoint & input : transaction->inputs()) {
+        bySpentOutpoint.emplace(input, transaction->id);
+    }
+    txnId_t txnId = transaction->id;
+    size_t size = transaction->dataSize();
+    totalSize += size;
+    ordered.emplace(arrivals, txnId);
+    byId.emplace(txnId, Entry{std::move(transaction), size, arrivals++});
+    return true;
+}
+
+bool MemPool::erase(txnId_t txnId) {
+    auto it = byId.find(txnId);
+    if (it == byId.end()) {
+        return false;
+    }
+    for (const Outpoint & input : it->second.transaction->inputs()) {
+        bySpentOutpoint.erase(input);
+    }
+    totalSize -= it->second.size;
+    ordered.erase(it->second.arrival);
+    byId.erase(it);
+    return true;
+}
+
+bool MemPool::contains(txnId_t txnId) const {
+    return byId.count(txnId) > 0;
+}
+
+TransactionPtr MemPool::find(txnId_t txnId) const {
+    auto it = byId.find(txnId);
+    return it == byId.end() ? nullptr : it->second.transaction;
+}
+
+bool MemPool::spends(const Outpoint & outpoint) const {
+    return bySpentOutpoint.count(outpoint) > 0;
+}
+
+void MemPool::removeConflicts(const Transaction & transaction) {
+    for (const Outpoint & input : transaction.inputs()) {
+        auto it = bySpentOutpoint.find(input);
+        if (it != bySpentOutpoint.end() && it->second != transaction.id) {
+            erase(it->second);
+        }
+    }
+}
+
+std::vector<TransactionPtr> MemPool::selectTransactions(size_t maxSize, size_t maxCount) const {
+    std::vector<TransactionPtr> selected;
+    size_t selectedSize = 0;
+    // Nothing smaller than an empty transaction can fit once less room than that is left
+    for (auto it = ordered.begin(); it != ordered.end() && selected.size() < maxCount && selectedSize + Transaction::dataSize(0, 0) <= maxSize; it++) {
+        const Entry & entry = byId.at(it->second);
+        if (selectedSize + entry.size > maxSize) {
+            continue;
+        }
+        selectedSize += entry.size;
+        selected.push_back(entry.transaction);
+    }
+    return selected;
+}
+
+size_t MemPool::size() const {
+    return byId.size();
+}
+
+size_t MemPool::dataSize() const {
+    return totalSize;
+}
+
+bool MemPool::empty() const {
+    return byId.empty();
+}
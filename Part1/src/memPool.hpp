@@ -0,0 +1,55 @@
+#ifndef MEMPOOL_H
+#define MEMPOOL_H
+
+#include "transaction.hpp"
+
+/*
+    Pending transactions of a miner, held by handle (never copied)
+    1) Hash index by txnId_t for O(1) lookup / erase
+    2) Conflict index by spent outpoint: the first transaction seen spending an output wins,
+       confirming a block evicts every pending transaction double-spending one of its inputs
+    3) Ordered view used to build block templates; transactions carry no fee in this model, so they are
+       taken oldest (first inserted) first and skipped when they no longer fit in the remaining block space
+*/
+class MemPool {
+    private:
+        struct Entry {
+            TransactionPtr transaction;
+            size_t size;
+            uint64_t arrival;
+        };
+
+        std::unordered_map<txnId_t, Entry> byId;
+        std::unordered_map<Outpoint, txnId_t, OutpointHash> bySpentOutpoint;
+        std::map<uint64_t, txnId_t> ordered;       // By arrival; ids carry the creator in their high bits, not the age
+        size_t totalSize;
+        uint64_t arrivals;
+
+    public:
+        MemPool();
+
+        /*
+            Returns false if the transaction is already pending or conflicts with a pending transaction
+        */
+        bool insert(TransactionPtr transaction);
+        bool erase(txnId_t txnId);
+        bool contains(txnId_t txnId) const;
+        TransactionPtr find(txnId_t txnId) const;
+        bool spends(const Outpoint & outpoint) const;      /* True if a pending transaction spends the outpoint */
+
+        /*
+            Evicts every pending transaction spending one of the inputs of the given (confirmed) transaction
+        */
+        void removeConflicts(const Transaction & transaction);
+
+        /*
+            Picks up to maxCount transactions, oldest first, whose total dataSize() stays within maxSize
+        */
+        std::vector<TransactionPtr> selectTransactions(size_t maxSize, size_t maxCount) const;
+
+        size_t size() const;
+        size_t dataSize() const;
+        bool empty() const;
+};
+
+#endif
@@ -0,0 +1,209 @@
+#include "metrics.hpp"
+#include <thread>
+#include <condition_variable>
+#include <cstdio>
+
+namespace Metrics {
+
+    static const char * COUNTER_NAMES[] = {
+        "blocks_accepted", "stale_blocks", "reorgs", "orphan_blocks", "orphans_connected", "orphans_evicted"
+    };
+
+    static const char * HISTOGRAM_NAMES[] = {
+        "validate_nanos", "reorg_depth", "mempool_size", "propagation_micros"
+    };
+
+    static const char * EVENT_NAMES[] = {
+        "RECEIVE_BROADCAST_TRANSACTION", "RECEIVE_BROADCAST_BLOCK", "BLOCK_CREATION", "BROADCAST_BLOCK",
+        "BROADCAST_TRANSACTION", "SEND_BROADCAST_BLOCK", "SEND_BROADCAST_TRANSACTION", "SEND_BLOCK_HEADER",
+        "RECEIVE_BLOCK_HEADER", "SEND_GET_COMPACT_BLOCK", "RECEIVE_GET_COMPACT_BLOCK", "SEND_COMPACT_BLOCK",
+        "RECEIVE_COMPACT_BLOCK", "SEND_GET_BLOCK_TXNS", "RECEIVE_GET_BLOCK_TXNS", "SEND_BLOCK_TXNS", "RECEIVE_BLOCK_TXNS"
+    };
+
+    static_assert(sizeof(COUNTER_NAMES) / sizeof(*COUNTER_NAMES) == static_cast<size_t>(Counter::COUNT), "One name per counter");
+    static_assert(sizeof(HISTOGRAM_NAMES) / sizeof(*HISTOGRAM_NAMES) == static_cast<size_t>(Histogram::COUNT), "One name per histogram");
+    static_assert(sizeof(EVENT_NAMES) / sizeof(*EVENT_NAMES) == EVENT_TYPES, "One name per event type");
+
+    const char * eventName(EventType type) {
+        return EVENT_NAMES[static_cast<size_t>(type)];
+    }
+
+    static const double PERCENTILES[] = {0.5, 0.9, 0.99, 0.999};
+
+    /*
+        Shards outlive their threads so that a report still sees what finished threads recorded
+    */
+    static std::mutex registryMutex;
+    static std::vector<std::unique_ptr<Shard>> registry;
+
+    Shard & local() {
+        thread_local Shard * shard = nullptr;
+        if (!shard) {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            registry.push_back(std::make_unique<Shard>());
+            shard = registry.back().get();
+        }
+        return *shard;
+    }
+
+    size_t bucketOf(uint64_t value) {
+        if (value < (1ULL << SUB_BUCKET_BITS)) {
+            return value;
+        }
+        size_t exponent = 63 - __builtin_clzll(value);
+        size_t subBucket = (value >> (exponent - SUB_BUCKET_BITS)) & ((1ULL << SUB_BUCKET_BITS) - 1);
+        return ((exponent - SUB_BUCKET_BITS + 1) << SUB_BUCKET_BITS) + subBucket;
+    }
+
+    uint64_t bucketLowerBound(size_t bucket) {
+        if (bucket < (1ULL << SUB_BUCKET_BITS)) {
+            return bucket;
+        }
+        size_t exponent = (bucket >> SUB_BUCKET_BITS) + SUB_BUCKET_BITS - 1;
+        uint64_t subBucket = bucket & ((1ULL << SUB_BUCKET_BITS) - 1);
+        return (1ULL << exponent) | subBucket << (exponent - SUB_BUCKET_BITS);
+    }
+
+    void record(Histogram histogram, uint64_t value) {
+        if (Speculation::capture([histogram, value] { record(histogram, value); })) {
+            return;
+        }
+        ShardHistogram & data = local().histograms[static_cast<size_t>(histogram)];
+        add(data.buckets[bucketOf(value)], 1);
+        add(data.count, 1);
+        add(data.sum, value);
+        if (value > data.max.load(std::memory_order_relaxed)) {
+            data.max.store(value, std::memory_order_relaxed);
+        }
+    }
+
+    uint64_t HistogramData::percentile(double fraction) const {
+        uint64_t rank = std::ceil(fraction * count);
+        uint64_t seen = 0;
+        for (size_t bucket = 0; bucket < BUCKETS; bucket++) {
+            seen += buckets[bucket];
+            if (seen >= rank && seen > 0) {
+                return std::min(bucketLowerBound(bucket), max);
+            }
+        }
+        return max;
+    }
+
+    struct Report {
+        uint64_t events[EVENT_TYPES] = {};
+        uint64_t counters[static_cast<size_t>(Counter::COUNT)] = {};
+        HistogramData histograms[static_cast<size_t>(Histogram::COUNT)];
+    };
+
+    static Report collect() {
+        Report report;
+        std::lock_guard<std::mutex> lock(registryMutex);
+        for (const std::unique_ptr<Shard> & shard : registry) {
+            for (size_t i = 0; i < EVENT_TYPES; i++) {
+                report.events[i] += shard->events[i].load(std::memory_order_relaxed);
+            }
+            for (size_t i = 0; i < static_cast<size_t>(Counter::COUNT); i++) {
+                report.counters[i] += shard->counters[i].load(std::memory_order_relaxed);
+            }
+            for (size_t i = 0; i < static_cast<size_t>(Histogram::COUNT); i++) {
+                const ShardHistogram & from = shard->histograms[i];
+                HistogramData & to = report.histograms[i];
+                for (size_t bucket = 0; bucket < BUCKETS; bucket++) {
+                    to.buckets[bucket] += from.buckets[bucket].load(std::memory_order_relaxed);
+                }
+                to.count += from.count.load(std::memory_order_relaxed);
+                to.sum += from.sum.load(std::memory_order_relaxed);
+                to.max = std::max(to.max, from.max.load(std::memory_order_relaxed));
+            }
+        }
+        return report;
+    }
+
+    void writeJson(std::ostream & out) {
+        Report report = collect();
+        out << "{\n  \"events\": {";
+        for (size_t i = 0; i < EVENT_TYPES; i++) {
+            out << (i ? ", " : "") << "\"" << EVENT_NAMES[i] << "\": " << report.events[i];
+        }
+        out << "},\n  \"counters\": {";
+        for (size_t i = 0; i < static_cast<size_t>(Counter::COUNT); i++) {
+            out << (i ? ", " : "") << "\"" << COUNTER_NAMES[i] << "\": " << report.counters[i];
+        }
+        out << "},\n  \"histograms\": {\n";
+        for (size_t i = 0; i < static_cast<size_t>(Histogram::COUNT); i++) {
+            const HistogramData & histogram = report.histograms[i];
+            out << "    \"" << HISTOGRAM_NAMES[i] << "\": {\"count\": " << histogram.count << ", \"sum\": " << histogram.sum
+                << ", \"max\": " << histogram.max;
+            for (double fraction : PERCENTILES) {
+                out << ", \"p" << fraction * 100 << "\": " << histogram.percentile(fraction);
+            }
+            out << "}" << (i + 1 < static_cast<size_t>(Histogram::COUNT) ? ",\n" : "\n");
+        }
+        out << "  }\n}\n";
+    }
+
+    void writePrometheus(std::ostream & out) {
+        Report report = collect();
+        out << "# TYPE sim_events_total counter\n";
+        for (size_t i = 0; i < EVENT_TYPES; i++) {
+            out << "sim_events_total{type=\"" << EVENT_NAMES[i] << "\"} " << report.events[i] << "\n";
+        }
+        for (size_t i = 0; i < static_cast<size_t>(Counter::COUNT); i++) {
+            out << "# TYPE sim_" << COUNTER_NAMES[i] << "_total counter\n";
+            out << "sim_" << COUNTER_NAMES[i] << "_total " << report.counters[i] << "\n";
+        }
+        for (size_t i = 0; i < static_cast<size_t>(Histogram::COUNT); i++) {
+            const HistogramData & histogram = report.histograms[i];
+            out << "# TYPE sim_" << HISTOGRAM_NAMES[i] << " summary\n";
+            for (double fraction : PERCENTILES) {
+                out << "sim_" << HISTOGRAM_NAMES[i] << "{quantile=\"" << fraction << "\"} " << histogram.percentile(fraction) << "\n";
+            }
+            out << "sim_" << HISTOGRAM_NAMES[i] << "_sum " << histogram.sum << "\n";
+            out << "sim_" << HISTOGRAM_NAMES[i] << "_count " << histogram.count << "\n";
+        }
+    }
+
+    static std::string reportPath;
+    static std::thread reporter;
+    static std::mutex reporterMutex;
+    static std::condition_variable reporterWake;
+    static bool reporterStopping = false;
+
+    static void writeReport() {
+        // Written aside and renamed, a scraper never reads a half-written file
+        std::string partial = reportPath + ".partial";
+        {
+            std::ofstream file(partial);
+            bool prometheus = reportPath.size() >= 5 && reportPath.compare(reportPath.size() - 5, 5, ".prom") == 0;
+            prometheus ? writePrometheus(file) : writeJson(file);
+        }
+        std::rename(partial.c_str(), reportPath.c_str());
+    }
+
+    void startReporter(const std::string & path, double intervalSeconds) {
+        reportPath = path;
+        if (intervalSeconds <= 0) {
+            return;
+        }
+        reporter = std::thread([intervalSeconds]() {
+            std::unique_lock<std::mutex> lock(reporterMutex);
+            while (!reporterWake.wait_for(lock, std::chrono::duration<double>(intervalSeconds), [] { return reporterStopping; })) {
+                writeReport();
+            }
+        });
+    }
+
+    void stopReporter() {
+        if (reporter.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(reporterMutex);
+                reporterStopping = true;
+            }
+            reporterWake.notify_all();
+            reporter.join();
+        }
+        if (!reportPath.empty()) {
+            writeReport();
+        }
+    }
+}
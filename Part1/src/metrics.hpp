@@ -0,0 +1,137 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include "def.hpp"
+#include "event.hpp"
+#include "speculation.hpp"
+
+/*
+    Run metrics: counters and log-linear (HDR style) histograms
+    1) Every thread records into its own shard without locks or atomic read-modify-writes, the shards are only
+       summed when a report is written, so recording costs a few plain stores
+    2) Built with SIM_METRICS (make METRICS=1, the default); without it the METRIC_* macros expand to nothing
+    3) Reports are JSON or Prometheus text exposition, written on demand or by a reporter thread at intervals
+    4) Speculative events only count once they commit (speculation.hpp)
+*/
+namespace Metrics {
+
+    enum class Counter : size_t {
+        BLOCKS_ACCEPTED,        // Blocks attached to a miner's tree
+        STALE_BLOCKS,           // Accepted blocks that did not become the tip of the receiving tree
+        REORGS,                 // Chain switches that disconnected at least one block
+        ORPHAN_BLOCKS,          // Blocks buffered because their parent was missing
+        ORPHANS_CONNECTED,
+        ORPHANS_EVICTED,
+        COUNT
+    };
+
+    enum class Histogram : size_t {
+        VALIDATE_NANOS,         // Wall time of BlockTree::validateChain
+        REORG_DEPTH,            // Blocks disconnected by a chain switch
+        MEMPOOL_SIZE,           // Pending transactions when a block template is built
+        PROPAGATION_MICROS,     // Simulated time from a block's creation to its acceptance by a peer
+        COUNT
+    };
+
+    static const size_t EVENT_TYPES = static_cast<size_t>(EventType::RECEIVE_BLOCK_TXNS) + 1;
+
+    /*
+        Buckets of 1/16 of a power of two: values below 16 are exact, larger ones within 6.25%
+    */
+    static const size_t SUB_BUCKET_BITS = 4;
+    static const size_t BUCKETS = (64 - SUB_BUCKET_BITS + 1) << SUB_BUCKET_BITS;
+
+    size_t bucketOf(uint64_t value);
+    uint64_t bucketLowerBound(size_t bucket);
+
+    /*
+        Summed histogram of a report
+    */
+    struct HistogramData {
+        std::vector<uint64_t> buckets = std::vector<uint64_t>(BUCKETS, 0);
+        uint64_t count = 0;
+        uint64_t sum = 0;
+        uint64_t max = 0;
+
+        uint64_t percentile(double fraction) const;
+    };
+
+    struct ShardHistogram {
+        std::atomic<uint64_t> buckets[BUCKETS] = {};
+        std::atomic<uint64_t> count{0};
+        std::atomic<uint64_t> sum{0};
+        std::atomic<uint64_t> max{0};
+    };
+
+    /*
+        Metrics of one thread, written by that thread only; reports read them with relaxed loads
+    */
+    struct Shard {
+        std::atomic<uint64_t> events[EVENT_TYPES] = {};
+        std::atomic<uint64_t> counters[static_cast<size_t>(Counter::COUNT)] = {};
+        ShardHistogram histograms[static_cast<size_t>(Histogram::COUNT)];
+    };
+
+    Shard & local();
+
+    inline void add(std::atomic<uint64_t> & value, uint64_t amount) {
+        value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+
+    inline void countEvent(EventType type) {
+        if (Speculation::capture([type] { countEvent(type); })) {
+            return;
+        }
+        add(local().events[static_cast<size_t>(type)], 1);
+    }
+
+    inline void count(Counter counter, uint64_t amount = 1) {
+        if (Speculation::capture([counter, amount] { count(counter, amount); })) {
+            return;
+        }
+        add(local().counters[static_cast<size_t>(counter)], amount);
+    }
+
+    void record(Histogram histogram, uint64_t value);
+
+    /*
+        Records the wall time between its construction and destruction in nanoseconds
+    */
+    class Timer {
+        private:
+            Histogram histogram;
+            std::chrono::steady_clock::time_point start;
+
+        public:
+            Timer(Histogram histogram) : histogram(histogram), start(std::chrono::steady_clock::now()) {}
+            ~Timer() {
+                record(histogram, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+            }
+    };
+
+    const char * eventName(EventType type);
+
+    void writeJson(std::ostream & out);
+    void writePrometheus(std::ostream & out);
+
+    /*
+        Writes the report to path (Prometheus text if it ends in .prom, JSON otherwise) every intervalSeconds of
+        wall time from a background thread (never if intervalSeconds is 0), and once more from stopReporter()
+    */
+    void startReporter(const std::string & path, double intervalSeconds);
+    void stopReporter();
+}
+
+#ifdef SIM_METRICS
+#define METRIC_EVENT(type) Metrics::countEvent(type)
+#define METRIC_COUNT(counter, ...) Metrics::count(Metrics::Counter::counter, ##__VA_ARGS__)
+#define METRIC_RECORD(histogram, value) Metrics::record(Metrics::Histogram::histogram, value)
+#define METRIC_TIMER(histogram) Metrics::Timer metricTimer(Metrics::Histogram::histogram)
+#else
+#define METRIC_EVENT(type) do {} while (0)
+#define METRIC_COUNT(counter, ...) do {} while (0)
+#define METRIC_RECORD(histogram, value) do {} while (0)
+#define METRIC_TIMER(histogram) do {} while (0)
+#endif
+
+#endif
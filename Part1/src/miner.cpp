@@ -1,15 +1,57 @@
 #include "miner.hpp"
+#include "metrics.hpp"
 
-Miner::Miner(int id, double hashPower, std::vector<minerId_t> neighbours)
+Miner::Miner(int id, double hashPower, std::vector<minerId_t> neighbours, RandomStream rng, int numMiners, RelayMode relayMode):
+    seenBlocks(SEEN_BLOCKS_CAPACITY),
+    seenTransactions(SEEN_TXNS_CAPACITY)
 {
     this->id = id;
+    this->numMiners = numMiners;
     this->hashPower = hashPower;
+    this->rng = rng;
+    this->ids = Counter(id);
     this->blockTree = BlockTree(id);
-    this->currentBlock = Block();
+    this->currentBlock = BlockStore::genesis();
     this->currentHeight = 0;
     this->currentScheduledBlock = nullptr;
+    if (neighbours.size() > MAX_PEERS) {
+        std::cerr << "Error: miner " << id << " has more than " << MAX_PEERS << " neighbours." << std::endl;
+        exit(1);
+    }
     this->neighbours = neighbours;
     this->currentScheduledTransactionTime = 0;
+    this->currentScheduledTransaction = nullptr;
+    this->relayMode = relayMode;
+}
+
+Miner::Miner(const Miner & other):
+    id(other.id),
+    numMiners(other.numMiners),
+    hashPower(other.hashPower),
+    rng(other.rng),
+    ids(other.ids),
+    memPool(other.memPool),
+    blockTree(other.blockTree),
+    currentBlock(other.currentBlock),
+    currentHeight(other.currentHeight),
+    currentScheduledBlock(other.currentScheduledBlock),
+    currentScheduledTransactionTime(other.currentScheduledTransactionTime),
+    currentScheduledTransaction(other.currentScheduledTransaction),
+    neighbours(other.neighbours),
+    seenBlocks(other.seenBlocks),
+    seenTransactions(other.seenTransactions),
+    relayMode(other.relayMode),
+    requestedBlocks(other.requestedBlocks)
+{}
+
+Miner & Miner::operator=(const Miner & other)
+{
+    if (this == &other)
+    {
+        return *this;
+    }
+    *this = Miner(other);
+    return *this;
 }
 
 std::vector<Event> Miner::receiveEvent(Event &event)
@@ -23,6 +65,18 @@ std::vector<Event> Miner::receiveEvent(Event &event)
         return receiveBroadcastBlock(event);
     case EventType::BLOCK_CREATION:
         return confirmBlock(event);
+    case EventType::BROADCAST_TRANSACTION:
+        return broadcastTransaction(event);
+    case EventType::RECEIVE_BLOCK_HEADER:
+        return receiveBlockHeader(event);
+    case EventType::RECEIVE_GET_COMPACT_BLOCK:
+        return receiveGetCompactBlock(event);
+    case EventType::RECEIVE_COMPACT_BLOCK:
+        return receiveCompactBlock(event);
+    case EventType::RECEIVE_GET_BLOCK_TXNS:
+        return receiveGetBlockTxns(event);
+    case EventType::RECEIVE_BLOCK_TXNS:
+        return receiveBlockTxns(event);
     default:
         return std::vector<Event>();
     }
@@ -30,80 +84,100 @@ std::vector<Event> Miner::receiveEvent(Event &event)
 
 std::vector<Event> Miner::confirmBlock(Event &event)
 {
-    int height = blockTree.getCurrentHeight();
-    if (!currentScheduledBlock || *currentScheduledBlock != *event.block || event.block->height <= height) // TODO: implement != operator for block
+    uint64_t height = blockTree.getCurrentHeight();
+    if (!currentScheduledBlock || *currentScheduledBlock != *event.block || event.block->height <= height)
     {
         return std::vector<Event>();
     }
-    currentBlock = *event.block;
-    for(auto txn : currentBlock.transactions){
-        if(memPool.find(txn) != memPool.end()){
-            memPool.erase(txn);
-        }
-
+    if (blockTree.addBlock(event.block, event.timestamp, memPool) < 0)
+    {
+        currentScheduledBlock = nullptr;
+        return std::vector<Event>();
     }
-    blockTree.addBlock(*event.block, event.timestamp, memPool);
-    return std::vector<Event>{event};
+    // Accepted, so interned: peers get the stored copy
+    currentBlock = BlockStore::find(event.block->id);
+    currentHeight = blockTree.getCurrentHeight();
+    currentScheduledBlock = nullptr;
+    blockTree.releaseReservations(memPool, currentScheduledTransaction.get());
+
+    std::vector<Event> newEvents;
+    relayBlock(currentBlock, event.timestamp, newEvents);
+    return newEvents;
 }
 
-std::vector<Event> Miner::generateBlock(time_t prev_time)
+std::vector<Event> Miner::generateBlock(simTime_t prev_time)
 {
     if ( currentScheduledBlock != nullptr )
     {
         return std::vector<Event>();
     }
 
-    currentScheduledBlock = nullptr;
-    time_t scheduleTime = prev_time + getExponentialRandom(BLOCK_INTER_ARRIVAL_TIME / hashPower);
+    simTime_t scheduleTime = prev_time + getExponentialRandom(rng, BLOCK_INTER_ARRIVAL_TIME / hashPower);
+    METRIC_RECORD(MEMPOOL_SIZE, memPool.size());
 
-    blockId_t scheduledBlockID = Counter::getBlockID();
-    txnId_t coinBaseTxnID = Counter::getTxnID();
-    currentScheduledBlock = new Block(scheduledBlockID, currentHeight + 1, currentBlock.id, scheduleTime);
+    txnId_t coinBaseTxnID = ids.getTxnID();
+    std::vector<Transaction> transactions;
 
-    Transaction coinbase = Transaction(coinBaseTxnID, std::vector<Utxo>(), std::vector<Utxo>{Utxo(scheduledBlockID, coinBaseTxnID, 0, id, MINING_REWARD)}, TransactionType::COINBASE);
+    Transaction coinbase = Transaction(coinBaseTxnID, std::vector<Outpoint>(), std::vector<Utxo>{Utxo(0, coinBaseTxnID, 0, id, MINING_REWARD)}, TransactionType::COINBASE);
 
-    currentScheduledBlock->transactions.push_back(coinbase);
+    transactions.push_back(std::move(coinbase));
 
-    if (memPool.size() == 0)
-    {
-        return std::vector<Event>{Event(EventType::BROADCAST_BLOCK, currentScheduledBlock, scheduleTime, id)};
+    // Add random number of transactions to the block, oldest first and within the block size limit
+    int num_txns = memPool.size() <= 1 ? memPool.size() : getUniformRandom(rng, 1, std::min((int)memPool.size(), 100));
+    size_t blockSpace = MB - sizeof(Block) - transactions.back().dataSize();
+    for(const TransactionPtr & txn : memPool.selectTransactions(blockSpace, num_txns)){
+        transactions.push_back(*txn);
+        memPool.erase(txn->id);
     }
 
-    // Add random transactions to the block
-    int num_txns = getUniformRandom(1, std::min((int)memPool.size(), 100));
-    for(int i = 0; i < num_txns; i++){
-        currentScheduledBlock->transactions.push_back(*(memPool.begin()));
-        for(Utxo& utxo : currentScheduledBlock->transactions.back().out_utxos){
+    // The id covers what the block holds, so a rollback re-running this with another parent, time or transaction
+    // set never reissues the id of the block it built the first time
+    uint64_t content = Counter::combine(currentBlock->id, std::hash<simTime_t>()(scheduleTime));
+    for(const Transaction & txn : transactions){
+        content = Counter::combine(content, txn.id);
+    }
+    blockId_t scheduledBlockID = ids.getBlockID(content);
+    for(Transaction & txn : transactions){
+        for(Utxo & utxo : txn.outputs()){
             utxo.block = scheduledBlockID;
         }
-        memPool.erase(memPool.begin());
     }
 
-    return std::vector<Event>{Event(EventType::BROADCAST_BLOCK, currentScheduledBlock, scheduleTime, id)};
+    // The block is frozen from here on (its transaction index included); it stays private to this miner and is
+    // released with it unless the tree accepts it (BlockTree::attachBlock interns it then)
+    currentScheduledBlock = std::make_shared<const Block>(scheduledBlockID, currentHeight + 1, currentBlock->id, std::move(transactions), scheduleTime);
+    std::vector<Event> newEvents;
+    newEvents.push_back(Event(EventType::BLOCK_CREATION, currentScheduledBlock, scheduleTime, id));
+    return newEvents;
 }
 
-std::vector<Event> Miner::generateTransaction(time_t prev_time)
+std::vector<Event> Miner::generateTransaction(simTime_t prev_time)
 {
-    if (prev_time < currentScheduledTransactionTime)
+    if (prev_time < currentScheduledTransactionTime || currentScheduledTransaction != nullptr)
     {
         return std::vector<Event>();
     }
     if(blockTree.getBalance() <= 0){
         return std::vector<Event>();
     }
-    time_t scheduleTime = prev_time + getExponentialRandom(TXN_INTER_ARRIVAL_TIME);
-    txnId_t txnID = Counter::getTxnID();
+    simTime_t scheduleTime = prev_time + getExponentialRandom(rng, TXN_INTER_ARRIVAL_TIME);
+    txnId_t txnID = ids.getTxnID();
 
-    int paymentAmount = getUniformRandom(1, blockTree.getBalance());
+    int paymentAmount = blockTree.getBalance() == 1 ? 1 : getUniformRandom(rng, 1, blockTree.getBalance());
     minerId_t paymentReceiver;
 
-    while((paymentReceiver = getUniformRandom(1, NUM_MINERS)) == id);
+    while((paymentReceiver = getUniformRandom(rng, 0, numMiners)) == id);
 
     int change;
-    std::vector<Utxo> in_utxos = blockTree.getUtxos(paymentAmount, change);
-    if ( in_utxos.empty() ) {
+    std::vector<Utxo> coins = blockTree.getUtxos(paymentAmount, change);
+    if ( coins.empty() ) {
         return std::vector<Event>();
     }
+    std::vector<Outpoint> inputs;
+    for (const Utxo & coin : coins){
+        inputs.push_back(coin.outpoint());
+    }
+    currentScheduledTransactionTime = scheduleTime;
     std::vector<Utxo> out_utxos;
 
     out_utxos.push_back(Utxo(-1, txnID, 0, paymentReceiver, paymentAmount));
@@ -111,70 +185,194 @@ std::vector<Event> Miner::generateTransaction(time_t prev_time)
         out_utxos.push_back(Utxo(-1, txnID, 1, id, change));
     }
 
-    Transaction txn = Transaction(txnID, in_utxos, out_utxos, TransactionType::NORMAL);
+    currentScheduledTransaction = std::make_shared<const Transaction>(txnID, inputs, out_utxos, TransactionType::NORMAL);
     std::vector<Event> newEvents;
-    newEvents.push_back(Event(EventType::BROADCAST_TRANSACTION, &txn, scheduleTime, id));
+    newEvents.push_back(Event(EventType::BROADCAST_TRANSACTION, currentScheduledTransaction, scheduleTime, id));
     return newEvents;
 }
 
 std::vector<Event> Miner::receiveBroadcastBlock(Event &event)
+{
+    seenBlocks.insert(event.block->id, event.owner);
+    return acceptBlock(event.block, event.timestamp);
+}
+
+std::vector<Event> Miner::acceptBlock(const BlockPtr & block, simTime_t timestamp)
 {
     std::vector<Event> newEvents;
-    int sendingMiner = event.owner;
-    blockToMiners[event.block->id].insert(sendingMiner);
+    requestedBlocks.erase(block->id);
 
-    if(blockTree.addBlock(*event.block, event.timestamp, memPool) < 0){
+    // Orphans connected by this block are relayed along with it
+    std::vector<BlockPtr> relayed{block};
+    if(blockTree.hasBlock(block->id) || blockTree.hasOrphan(block->id) || blockTree.addBlock(block, timestamp, memPool, &relayed) < 0){
         return newEvents;
     }
+    METRIC_RECORD(PROPAGATION_MICROS, (timestamp - block->timestamp) * 1e6);
 
     if(blockTree.getCurrentHeight() > currentHeight){
-        // TODO: Add back transactions to mempool
-        for (auto txn: currentScheduledBlock->transactions){
-            memPool.insert(txn);
-        }
-        for ( auto txn : event.block->transactions){
-            memPool.erase(txn);
+        // The abandoned template's transactions go back to the mempool unless the new chain confirmed them, in any
+        // of its blocks (the tree already took its own transactions out of the mempool when switching to it)
+        if (currentScheduledBlock != nullptr){
+            for (const Transaction & txn: currentScheduledBlock->transactions){
+                if (txn.type != TransactionType::COINBASE && blockTree.isSpendable(txn)){
+                    memPool.insert(TransactionPtr(currentScheduledBlock, &txn));
+                }
+            }
         }
+        // Our transactions the switch evicted or that are now conflicting free their coins, all pending ones are
+        // back in the mempool by now
+        blockTree.releaseReservations(memPool, currentScheduledTransaction.get());
         currentScheduledBlock = nullptr;
-        currentBlock = *event.block;
+        currentBlock = BlockStore::find(blockTree.getCurrent()->id);
         currentHeight = blockTree.getCurrentHeight();
-        std::vector<Event> newEvents = generateBlock(event.timestamp);
-        newEvents.insert(newEvents.end(), newEvents.begin(), newEvents.end());
+        newEvents = generateBlock(timestamp);
+    }
+    for(const BlockPtr & relayedBlock : relayed){
+        relayBlock(relayedBlock, timestamp, newEvents);
+    }
+    return newEvents;
+}
+
+void Miner::relayBlock(const BlockPtr & block, simTime_t timestamp, std::vector<Event> & newEvents)
+{
+    EventType type = relayMode == RelayMode::COMPACT ? EventType::SEND_BLOCK_HEADER : EventType::SEND_BROADCAST_BLOCK;
+    Event multicast(type, block, timestamp, id);
+    for(size_t i = 0; i < neighbours.size(); i++){
+        if(seenBlocks.insert(block->id, neighbours[i])){
+            multicast.peers |= 1ULL << i;
+        }
+    }
+    if(multicast.peers != 0){
+        newEvents.push_back(std::move(multicast));
+    }
+}
+
+std::vector<Event> Miner::receiveBlockHeader(Event &event)
+{
+    std::vector<Event> newEvents;
+    seenBlocks.insert(event.block->id, event.owner);
+    // Only the first peer announcing an unknown block is asked for it
+    if(blockTree.hasBlock(event.block->id) || blockTree.hasOrphan(event.block->id) || !requestedBlocks.insert(event.block->id).second){
+        return newEvents;
     }
-    for(auto peer: neighbours){
-        if(blockToMiners[event.block->id].find(peer) == blockToMiners[event.block->id].end()){
-            blockToMiners[event.block->id].insert(peer);
-            newEvents.push_back(Event(EventType::SEND_BROADCAST_BLOCK, event.block, event.timestamp, id));
+    newEvents.push_back(Event(EventType::SEND_GET_COMPACT_BLOCK, event.block, event.timestamp, id, event.owner));
+    return newEvents;
+}
+
+std::vector<Event> Miner::receiveGetCompactBlock(Event &event)
+{
+    // Header, the coinbase in full (nobody else has it) and a short id for every other transaction
+    const Block & block = *event.block;
+    std::vector<Event> newEvents;
+    Event compactBlock(EventType::SEND_COMPACT_BLOCK, event.block, event.timestamp, id, event.owner);
+    compactBlock.payloadSize = HEADER_BYTES + SHORT_TXN_ID_BYTES * (block.transactions.size() - 1) + block.transactions.front().dataSize();
+    newEvents.push_back(std::move(compactBlock));
+    return newEvents;
+}
+
+std::vector<Event> Miner::receiveCompactBlock(Event &event)
+{
+    // Rebuilding the block from the mempool and our own block template (generateBlock takes its transactions out
+    // of the mempool), whatever is in neither has to be fetched from the sender
+    uint32_t missingSize = 0;
+    for (const Transaction & txn : event.block->transactions){
+        if (txn.type != TransactionType::COINBASE && !memPool.contains(txn.id) &&
+            !(currentScheduledBlock && currentScheduledBlock->findTransaction(txn.id))){
+            missingSize += txn.dataSize();
         }
     }
+    if (missingSize == 0){
+        return acceptBlock(event.block, event.timestamp);
+    }
+    std::vector<Event> newEvents;
+    Event request(EventType::SEND_GET_BLOCK_TXNS, event.block, event.timestamp, id, event.owner);
+    request.payloadSize = missingSize;
+    newEvents.push_back(std::move(request));
+    return newEvents;
+}
+
+std::vector<Event> Miner::receiveGetBlockTxns(Event &event)
+{
+    std::vector<Event> newEvents;
+    Event reply(EventType::SEND_BLOCK_TXNS, event.block, event.timestamp, id, event.owner);
+    reply.payloadSize = event.payloadSize;
+    newEvents.push_back(std::move(reply));
     return newEvents;
 }
 
+std::vector<Event> Miner::receiveBlockTxns(Event &event)
+{
+    return acceptBlock(event.block, event.timestamp);
+}
 
-std::vector<Event> Miner::receiveBroadcastTransaction(Event &event){
-    memPool.insert(*event.transaction);
-    blockToTransactions[event.block->id].insert(event.transaction->id);
 
+std::vector<Event> Miner::receiveBroadcastTransaction(Event &event){
     std::vector<Event> newEvents;
+    const Transaction & transaction = *event.transaction;
+    seenTransactions.insert(transaction.id, event.owner);
+    // The filter is only a fast first check for the common duplicate, a transaction still pending: it can report
+    // a new transaction as seen (false positive) and forget a confirmed one (rolled out), so what it cannot settle
+    // is decided against the mempool, our block template and the tip's UTXO set
+    if (!seenTransactions.insert(transaction.id) && memPool.contains(transaction.id)){
+        return newEvents;
+    }
+    if ((currentScheduledBlock && currentScheduledBlock->findTransaction(transaction.id)) ||
+        !blockTree.isSpendable(transaction) || !memPool.insert(event.transaction)){
+        return newEvents;
+    }
 
-    for (auto peer: neighbours){
-        if(blockToMiners[event.block->id].find(peer) == blockToMiners[event.block->id].end()){
-            blockToMiners[event.block->id].insert(peer);
-            newEvents.push_back(Event(EventType::SEND_BROADCAST_TRANSACTION, event.transaction, event.timestamp, id));
+    Event multicast(EventType::SEND_BROADCAST_TRANSACTION, event.transaction, event.timestamp, id);
+    for (size_t i = 0; i < neighbours.size(); i++){
+        if(seenTransactions.insert(event.transaction->id, neighbours[i])){
+            multicast.peers |= 1ULL << i;
         }
     }
+    if (multicast.peers != 0){
+        newEvents.push_back(std::move(multicast));
+    }
 
     return newEvents;
 }
 
-void Miner::addEvent(Event &event){
-    eventList.push_back(event);
+std::vector<Event> Miner::broadcastTransaction(Event &event){
+    // Our own transaction reached its creation time: keep it for mining and flood it to every peer
+    std::vector<Event> newEvents;
+    currentScheduledTransaction = nullptr;
+    memPool.insert(event.transaction);
+    seenTransactions.insert(event.transaction->id);
+    Event multicast(EventType::SEND_BROADCAST_TRANSACTION, event.transaction, event.timestamp, id);
+    for (size_t i = 0; i < neighbours.size(); i++){
+        seenTransactions.insert(event.transaction->id, neighbours[i]);
+        multicast.peers |= 1ULL << i;
+    }
+    if (multicast.peers != 0){
+        newEvents.push_back(std::move(multicast));
+    }
+    return newEvents;
 }
 
-std::vector<Event> Miner::getEventList(time_t timestamp){
+void Miner::addEvent(Event &&event){
+    eventList.push_back(std::move(event));
+}
+
+std::vector<Event> Miner::getEventList(simTime_t timestamp){
     std::vector<Event> newEvents = generateBlock(timestamp);
-    eventList.insert(eventList.end(), newEvents.begin(), newEvents.end());
+    eventList.insert(eventList.end(), std::make_move_iterator(newEvents.begin()), std::make_move_iterator(newEvents.end()));
     newEvents = generateTransaction(timestamp);
-    eventList.insert(eventList.end(), newEvents.begin(), newEvents.end());
-    return eventList;
-}
\ No newline at end of file
+    eventList.insert(eventList.end(), std::make_move_iterator(newEvents.begin()), std::make_move_iterator(newEvents.end()));
+    std::vector<Event> events;
+    events.swap(eventList);
+    return events;
+}
+
+minerId_t Miner::getId() const {
+    return id;
+}
+
+const std::vector<minerId_t> & Miner::getNeighbours() const {
+    return neighbours;
+}
+
+const BlockTree & Miner::getBlockTree() const {
+    return blockTree;
+}
@@ -4,20 +4,38 @@
 #include "event.hpp"
 #include "utils.hpp"
 #include "blockTree.hpp"
+#include "seenFilter.hpp"
+
+/*
+    How a miner forwards blocks to its peers
+    1) FULL: the whole block is pushed to every peer that may not have it
+    2) COMPACT: peers get the header only and ask for a compact block (header, coinbase and a short id per
+       transaction); transactions missing from their mempool are fetched in one more round trip
+*/
+enum class RelayMode {
+    FULL,
+    COMPACT
+};
 
 class Miner {
     private:
         minerId_t id;
+        int numMiners;
         double hashPower;
-        std::set<Transaction> memPool;
+        RandomStream rng;      // Private stream, split from the run seed
+        Counter ids;           // Ids of the blocks and transactions this miner creates
+        MemPool memPool;
         BlockTree blockTree;
-        Block currentBlock;    // Block on which the miner is currently working  
+        BlockPtr currentBlock;    // Block on which the miner is currently working  
         int currentHeight;
-        Block * currentScheduledBlock; //Block which is scheduled on main thread
-        time_t currentScheduledTransactionTime;
+        BlockPtr currentScheduledBlock; //Block which is scheduled on main thread
+        simTime_t currentScheduledTransactionTime;
+        TransactionPtr currentScheduledTransaction; // Holds reserved coins but is not in the mempool until broadcast
         std::vector<minerId_t> neighbours;
-        std::unordered_map<blockId_t, std::set<minerId_t> > blockToMiners;
-        std::unordered_map<blockId_t, std::set<minerId_t> > blockToTransactions;
+        SeenFilter seenBlocks;              // Block ids seen, and (block id, peer) pairs of peers known to have the block
+        SeenFilter seenTransactions;        // Same for transaction ids
+        RelayMode relayMode;
+        std::unordered_set<blockId_t> requestedBlocks;     // Compact relay: blocks asked for and not received yet
 
         std::vector<Event> eventList;
 
@@ -28,17 +46,50 @@ class Miner {
             3) BROADCAST_BLOCK                      - A way of letting you know that your previous block has been broadcasted
             4) BROADCAST_TRANSACTION                - A way of letting you know that your previous transaction has been broadcasted
             5) BLOCK_CREATION                       - Confirmation 
+            6) RECEIVE_BLOCK_HEADER, RECEIVE_GET_COMPACT_BLOCK, RECEIVE_COMPACT_BLOCK, RECEIVE_GET_BLOCK_TXNS,
+               RECEIVE_BLOCK_TXNS                   - Compact relay messages
+        Events returned by the miner are handed to the scheduler; SEND_* events carry the peer in Event::receiver
         */
         std::vector<Event> receiveBroadcastTransaction(Event &event);
         std::vector<Event> receiveBroadcastBlock(Event &event);
-        std::vector<Event> generateBlock(time_t prev_time);
-        std::vector<Event> generateTransaction(time_t prev_time);
+        std::vector<Event> receiveBlockHeader(Event &event);
+        std::vector<Event> receiveGetCompactBlock(Event &event);
+        std::vector<Event> receiveCompactBlock(Event &event);
+        std::vector<Event> receiveGetBlockTxns(Event &event);
+        std::vector<Event> receiveBlockTxns(Event &event);
+        /*
+            Adds a block received in full (or rebuilt from a compact block) to the tree, switches to the new longest
+            chain if it grew and relays the block together with the orphans it connected
+        */
+        std::vector<Event> acceptBlock(const BlockPtr & block, simTime_t timestamp);
+        /*
+            Sends the block, or its header in compact mode, to every peer not known to have it
+        */
+        void relayBlock(const BlockPtr & block, simTime_t timestamp, std::vector<Event> & newEvents);
+        std::vector<Event> generateBlock(simTime_t prev_time);
+        std::vector<Event> generateTransaction(simTime_t prev_time);
         std::vector<Event> confirmBlock(Event &event);
+        std::vector<Event> broadcastTransaction(Event &event);
     public:
-        Miner(int id, double hashPower, std::vector<minerId_t> neighbours);
+        Miner(int id, double hashPower, std::vector<minerId_t> neighbours, RandomStream rng, int numMiners = NUM_MINERS, RelayMode relayMode = RelayMode::FULL);
+        /*
+            Copies are full, independent snapshots of the miner (block tree included), used as checkpoints
+            Events not yet handed over through getEventList() are not part of a snapshot
+        */
+        Miner(const Miner & other);
+        Miner & operator=(const Miner & other);
+        Miner(Miner && other) = default;
+        Miner & operator=(Miner && other) = default;
         std::vector<Event> receiveEvent(Event &event);
-        std::vector<Event> getEventList(time_t timestamp);
-        void addEvent(Event &event);
+        /*
+            Schedules the next block / transaction generation if none is pending and
+            hands every event queued so far over to the caller (the list is emptied)
+        */
+        std::vector<Event> getEventList(simTime_t timestamp);
+        void addEvent(Event &&event);
+        minerId_t getId() const;
+        const std::vector<minerId_t> & getNeighbours() const;
+        const BlockTree & getBlockTree() const;
 };
 
 #endif
\ No newline at end of file
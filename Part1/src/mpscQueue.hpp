@@ -0,0 +1,67 @@
+#ifndef MPSC_QUEUE_H
+#define MPSC_QUEUE_H
+
+#include "def.hpp"
+#include <optional>
+
+/*
+    Unbounded lock-free multi-producer single-consumer queue (D. Vyukov's intrusive node queue)
+    1) push() is wait-free: one atomic exchange on the tail
+    2) pop() is only called by the owning consumer and preserves each producer's push order
+*/
+template <typename T>
+class MpscQueue {
+    private:
+        struct Node {
+            std::atomic<Node*> next;
+            std::optional<T> value;     // Empty for the stub node
+            Node() : next(nullptr) {}
+            Node(T && value) : next(nullptr), value(std::move(value)) {}
+        };
+
+        // The consumer-side head is kept off the producers' cache line
+        alignas(64) std::atomic<Node*> tail;
+        alignas(64) Node * head;
+
+    public:
+        MpscQueue() {
+            Node * stub = new Node();
+            head = stub;
+            tail.store(stub, std::memory_order_relaxed);
+        }
+
+        ~MpscQueue() {
+            while (head) {
+                Node * next = head->next.load(std::memory_order_relaxed);
+                delete head;
+                head = next;
+            }
+        }
+
+        MpscQueue(const MpscQueue &) = delete;
+        MpscQueue & operator=(const MpscQueue &) = delete;
+
+        void push(T value) {
+            Node * node = new Node(std::move(value));
+            Node * previous = tail.exchange(node, std::memory_order_acq_rel);
+            previous->next.store(node, std::memory_order_release);
+        }
+
+        /*
+            Hands every item pushed so far to consumer (as T&&), oldest first, and returns how many there were
+        */
+        template <typename Consumer>
+        size_t drain(Consumer consumer) {
+            size_t count = 0;
+            for (Node * next = head->next.load(std::memory_order_acquire); next; next = head->next.load(std::memory_order_acquire)) {
+                consumer(std::move(*next->value));
+                next->value.reset();
+                delete head;
+                head = next;
+                count++;
+            }
+            return count;
+        }
+};
+
+#endif
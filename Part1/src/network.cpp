@@ -0,0 +1,68 @@
+#include "network.hpp"
+
+Network::Network(const std::vector<std::vector<minerId_t>> & adjacency, RandomStream rng) {
+    size_t numMiners = adjacency.size();
+    fast.resize(numMiners);
+    for (size_t i = 0; i < numMiners; i++) {
+        fast[i] = getUniformRandom(rng, 0, 1) >= SLOW_NODE_FRACTION;
+    }
+
+    linkBegin.reserve(numMiners + 1);
+    minPropagation = MAX_PROPAGATION_DELAY;
+    for (size_t i = 0; i < numMiners; i++) {
+        linkBegin.push_back(links.size());
+        for (minerId_t j : adjacency[i]) {
+            // Drawn by the lower endpoint, reused by the higher one so both directions share rho
+            auto reverse = linkIndex.find(std::make_pair((int) j, (int) i));
+            simTime_t propagation = reverse != linkIndex.end() ? links[reverse->second].propagation
+                                                               : getUniformRandom(rng, MIN_PROPAGATION_DELAY, MAX_PROPAGATION_DELAY);
+            double bandwidth = fast[i] && fast[j] ? FAST_LINK_BANDWIDTH : SLOW_LINK_BANDWIDTH;
+            linkIndex[std::make_pair((int) i, (int) j)] = links.size();
+            links.push_back(Link{propagation, bandwidth, 0});
+            minPropagation = std::min(minPropagation, propagation);
+        }
+    }
+    linkBegin.push_back(links.size());
+
+    senders.resize(numMiners);
+    for (Sender & sender : senders) {
+        sender.rng = rng.split();
+    }
+}
+
+simTime_t Network::send(minerId_t from, minerId_t to, size_t messageBytes, simTime_t sendTime) {
+    Link & link = links[linkIndex.at(std::make_pair((int) from, (int) to))];
+    simTime_t start = std::max(sendTime, link.busyUntil);
+    link.busyUntil = start + messageBytes * 8 / link.bandwidth;
+    Sender & sender = senders[from];
+    if (sender.nextDelay == QUEUEING_BATCH) {
+        sender.rng.fillExponential(sender.unitDelays, QUEUEING_BATCH, 1.0);
+        sender.nextDelay = 0;
+    }
+    // Same values, in the same order, as drawing each delay with its own mean
+    simTime_t queueing = sender.unitDelays[sender.nextDelay++] * (QUEUEING_DELAY_BITS / link.bandwidth);
+    return link.busyUntil + link.propagation + queueing - sendTime;
+}
+
+simTime_t Network::minLatency() const {
+    return minPropagation;
+}
+
+bool Network::isFast(minerId_t miner) const {
+    return fast[miner];
+}
+
+Network::SenderState Network::saveSender(minerId_t sender) const {
+    SenderState state{senders[sender], {}};
+    for (uint32_t i = linkBegin[sender]; i < linkBegin[sender + 1]; i++) {
+        state.busyUntil.push_back(links[i].busyUntil);
+    }
+    return state;
+}
+
+void Network::restoreSender(minerId_t sender, const SenderState & state) {
+    senders[sender] = state.sender;
+    for (uint32_t i = linkBegin[sender]; i < linkBegin[sender + 1]; i++) {
+        links[i].busyUntil = state.busyUntil[i - linkBegin[sender]];
+    }
+}
@@ -0,0 +1,65 @@
+#ifndef NETWORK_H
+#define NETWORK_H
+
+#include "utils.hpp"
+
+/*
+    Links of the P2P graph and their latency model: a message of m bits sent on i->j at time t arrives at
+        max(t, busyUntil_ij) + m / c_ij + rho_ij + d_ij
+    1) rho_ij (propagation) is drawn once per link, the same both ways; c_ij is fast only between two fast nodes
+    2) d_ij (queueing at the receiver) is drawn per message from the sender's own stream, QUEUEING_BATCH unit
+       exponentials at a time (RandomStream::fillExponential) then scaled by the link's mean
+    3) A link transmits one message at a time: busyUntil_ij is when its last message finished going out, so a
+       large block delays everything queued behind it on that link
+    4) Links of a sender are stored contiguously and found through a hash index, O(1) per send
+    Only the sender's links and stream are touched by a send, so partitions may send for their own miners
+    concurrently and a sender's state can be saved / restored on its own (optimistic rollback)
+*/
+class Network {
+    public:
+        static const size_t QUEUEING_BATCH = 64;
+
+        struct Sender {
+            RandomStream rng;
+            double unitDelays[QUEUEING_BATCH];      // Exponentials of mean 1, used from nextDelay on
+            size_t nextDelay = QUEUEING_BATCH;
+        };
+
+        struct SenderState {
+            Sender sender;
+            std::vector<simTime_t> busyUntil;
+        };
+
+    private:
+        struct Link {
+            simTime_t propagation;
+            double bandwidth;
+            simTime_t busyUntil;
+        };
+
+        std::vector<Link> links;                // Links of sender i are links[linkBegin[i], linkBegin[i + 1])
+        std::vector<uint32_t> linkBegin;
+        std::unordered_map<std::pair<int, int>, uint32_t, pair_hash> linkIndex;
+        std::vector<Sender> senders;
+        std::vector<bool> fast;
+        simTime_t minPropagation;
+
+    public:
+        Network(const std::vector<std::vector<minerId_t>> & adjacency, RandomStream rng);
+
+        /*
+            Latency of a message of messageBytes sent from -> to at sendTime, reserves the link for its transmission
+        */
+        simTime_t send(minerId_t from, minerId_t to, size_t messageBytes, simTime_t sendTime);
+
+        /*
+            Lower bound of any latency, the lookahead of parallel execution
+        */
+        simTime_t minLatency() const;
+        bool isFast(minerId_t miner) const;
+
+        SenderState saveSender(minerId_t sender) const;
+        void restoreSender(minerId_t sender, const SenderState & state);
+};
+
+#endif
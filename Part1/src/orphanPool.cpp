@@ -0,0 +1,72 @@
+#include "orphanPool.hpp"
+#include "metrics.hpp"
+
+OrphanPool::OrphanPool(size_t capacity):
+    capacity(std::max<size_t>(capacity, 1)),
+    nextSequence(0)
+{}
+
+bool OrphanPool::add(BlockPtr block, simTime_t arrivalTime) {
+    if ( orphans.count(block->id) ) {
+        return false;
+    }
+    if ( orphans.size() >= capacity ) {
+        this->erase(byAge.begin()->second);
+        METRIC_COUNT(ORPHANS_EVICTED);
+    }
+    blockId_t blockId = block->id;
+    byParent[block->parent_id].push_back(blockId);
+    byAge.emplace(nextSequence, blockId);
+    orphans.emplace(blockId, Entry{Orphan{std::move(block), arrivalTime}, nextSequence++});
+    return true;
+}
+
+bool OrphanPool::contains(blockId_t blockId) const {
+    return orphans.count(blockId) > 0;
+}
+
+void OrphanPool::erase(blockId_t blockId) {
+    auto found = orphans.find(blockId);
+    if ( found == orphans.end() ) {
+        return;
+    }
+    auto siblings = byParent.find(found->second.orphan.block->parent_id);
+    siblings->second.erase(std::find(siblings->second.begin(), siblings->second.end(), blockId));
+    if ( siblings->second.empty() ) {
+        byParent.erase(siblings);
+    }
+    byAge.erase(found->second.sequence);
+    orphans.erase(found);
+}
+
+std::vector<OrphanPool::Orphan> OrphanPool::takeChildren(blockId_t parentId) {
+    std::vector<Orphan> children;
+    auto waiting = byParent.find(parentId);
+    if ( waiting == byParent.end() ) {
+        return children;
+    }
+    std::vector<blockId_t> childIds = std::move(waiting->second);
+    byParent.erase(waiting);
+    for ( blockId_t childId : childIds ) {
+        auto found = orphans.find(childId);
+        byAge.erase(found->second.sequence);
+        children.push_back(std::move(found->second.orphan));
+        orphans.erase(found);
+    }
+    return children;
+}
+
+void OrphanPool::dropDescendants(blockId_t parentId) {
+    std::vector<blockId_t> pending{parentId};
+    while ( ! pending.empty() ) {
+        blockId_t blockId = pending.back();
+        pending.pop_back();
+        for ( Orphan & child : this->takeChildren(blockId) ) {
+            pending.push_back(child.block->id);
+        }
+    }
+}
+
+size_t OrphanPool::size() const {
+    return orphans.size();
+}
@@ -0,0 +1,56 @@
+#ifndef ORPHAN_POOL_H
+#define ORPHAN_POOL_H
+
+#include "block.hpp"
+
+/*
+    Blocks received before their parent, waiting to be connected to a tree
+    1) Indexed by the missing parent id, so connecting a block hands back all of its waiting children at once
+    2) Bounded: once capacity orphans are held, the one received first is evicted (it is the most likely to be
+       stale or to have a parent that never arrives)
+    3) Orphans whose parent is rejected can never connect and are dropped together with their own descendants
+*/
+class OrphanPool {
+    public:
+        struct Orphan {
+            BlockPtr block;
+            simTime_t arrivalTime;
+        };
+
+    private:
+        struct Entry {
+            Orphan orphan;
+            uint64_t sequence;
+        };
+
+        size_t capacity;
+        uint64_t nextSequence;
+        std::unordered_map<blockId_t, Entry> orphans;
+        std::unordered_map<blockId_t, std::vector<blockId_t>> byParent;
+        std::map<uint64_t, blockId_t> byAge;
+
+        void erase(blockId_t blockId);
+
+    public:
+        OrphanPool(size_t capacity = MAX_ORPHAN_BLOCKS);
+
+        /*
+            Returns false if the block is already held
+        */
+        bool add(BlockPtr block, simTime_t arrivalTime);
+        bool contains(blockId_t blockId) const;
+
+        /*
+            Removes and returns the orphans waiting for parentId, oldest first
+        */
+        std::vector<Orphan> takeChildren(blockId_t parentId);
+
+        /*
+            Drops every orphan descending from parentId
+        */
+        void dropDescendants(blockId_t parentId);
+
+        size_t size() const;
+};
+
+#endif
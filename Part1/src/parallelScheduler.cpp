@@ -0,0 +1,123 @@
+#include "parallelScheduler.hpp"
+
+ParallelScheduler::ParallelScheduler(std::vector<Miner> & miners, RandomStream rng, size_t numThreads):
+    Scheduler(miners, rng),
+    numThreads(std::max<size_t>(1, std::min(numThreads, miners.size()))),
+    lookahead(minLinkLatency()),
+    barrier(this->numThreads)
+{
+    if (lookahead <= 0) {
+        throw std::invalid_argument("Parallel execution needs a positive minimum link latency.");
+    }
+    for (size_t i = 0; i < this->numThreads; i++) {
+        partitions.push_back(std::make_unique<Partition>(TXN_INTER_ARRIVAL_TIME * this->numThreads / std::max<size_t>(miners.size(), 1)));
+    }
+}
+
+size_t ParallelScheduler::partitionOf(minerId_t miner) const {
+    return miner % numThreads;
+}
+
+void ParallelScheduler::deliver(Partition & partition, Event && event) {
+    if (!event.arrivals.empty() && numThreads > 1) {
+        // One multicast per destination partition, as a partition only pops deliveries to its own miners
+        std::vector<std::vector<Event::Arrival>> byPartition(numThreads);
+        for (const Event::Arrival & arrival : event.takeArrivals()) {
+            byPartition[partitionOf(arrival.receiver)].push_back(arrival);
+        }
+        for (std::vector<Event::Arrival> & arrivals : byPartition) {
+            if (!arrivals.empty()) {
+                Event multicast = event.forPeer(event.receiver);
+                multicast.setArrivals(std::move(arrivals));
+                deliverOne(partition, std::move(multicast));
+            }
+        }
+        return;
+    }
+    deliverOne(partition, std::move(event));
+}
+
+void ParallelScheduler::deliverOne(Partition & partition, Event && event) {
+    Partition & destination = *partitions[partitionOf(event.receiver)];
+    if (&destination == &partition) {
+        partition.queue.push(event.timestamp, std::move(event));
+    } else {
+        destination.inbox.push(std::move(event));
+    }
+}
+
+void ParallelScheduler::mergeInbox(Partition & partition) {
+    partition.incoming.clear();
+    partition.inbox.drain([&partition](Event && event) { partition.incoming.push_back(std::move(event)); });
+    // Producers interleave arbitrarily, sort so that a run does not depend on thread timing;
+    // events from one sender keep their order as each sender's events come from a single producer
+    std::stable_sort(partition.incoming.begin(), partition.incoming.end(), [](const Event & a, const Event & b) {
+        return a.timestamp < b.timestamp || (a.timestamp == b.timestamp && (a.owner < b.owner || (a.owner == b.owner && a.receiver < b.receiver)));
+    });
+    for (Event & event : partition.incoming) {
+        partition.queue.push(event.timestamp, std::move(event));
+    }
+}
+
+void ParallelScheduler::worker(size_t index, simTime_t endTime) {
+    Partition & partition = *partitions[index];
+    std::vector<Event> newEvents;
+
+    for (size_t miner = index; miner < miners.size(); miner += numThreads) {
+        for (Event & event : miners[miner].getEventList(0)) {
+            route(event);
+            deliver(partition, std::move(event));
+        }
+    }
+    barrier.wait();
+
+    while (true) {
+        mergeInbox(partition);
+        partition.nextTime = partition.queue.empty() ? std::numeric_limits<simTime_t>::infinity() : partition.queue.topTime();
+        barrier.wait();
+
+        simTime_t windowStart = std::numeric_limits<simTime_t>::infinity();
+        for (const auto & other : partitions) {
+            windowStart = std::min(windowStart, other->nextTime);
+        }
+        if (windowStart > endTime) {
+            break;
+        }
+
+        // Nothing another partition sends from now on can arrive before windowEnd
+        simTime_t windowEnd = windowStart + lookahead;
+        while (!partition.queue.empty() && partition.queue.topTime() < windowEnd && partition.queue.topTime() <= endTime) {
+            Event event = partition.queue.pop(&partition.now);
+            if (!event.arrivals.empty()) {
+                Event rest = event.nextDelivery();
+                partition.queue.push(rest.timestamp, std::move(rest));
+            }
+            newEvents.clear();
+            dispatch(event, partition.now, newEvents);
+            for (Event & newEvent : newEvents) {
+                deliver(partition, std::move(newEvent));
+            }
+            partition.processedEvents++;
+        }
+        barrier.wait();
+    }
+}
+
+void ParallelScheduler::run(simTime_t endTime) {
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < numThreads; i++) {
+        threads.emplace_back(&ParallelScheduler::worker, this, i, endTime);
+    }
+    for (std::thread & thread : threads) {
+        thread.join();
+    }
+
+    for (const auto & partition : partitions) {
+        processedEvents += partition->processedEvents;
+        partition->processedEvents = 0;
+        now = std::max(now, partition->now);
+    }
+    wallSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
@@ -0,0 +1,48 @@
+#ifndef PARALLEL_SCHEDULER_H
+#define PARALLEL_SCHEDULER_H
+
+#include "scheduler.hpp"
+#include "mpscQueue.hpp"
+#include "barrier.hpp"
+
+/*
+    Conservative parallel discrete-event execution (synchronous windows)
+    1) Miners are partitioned over worker threads, each partition owns a calendar queue and only ever touches its own miners
+    2) Miners only interact through messages that cross a link, and every link delays a message by at least
+       minLinkLatency(); so once all partitions agree on the global earliest pending time T, every event before
+       T + lookahead can be processed without waiting for anyone
+    3) Events for a miner of another partition go through that partition's lock-free inbox and are merged into its
+       queue at the next window boundary, in a deterministic order
+*/
+class ParallelScheduler : public Scheduler {
+    private:
+        struct alignas(64) Partition {
+            CalendarQueue<Event> queue;
+            MpscQueue<Event> inbox;
+            std::vector<Event> incoming;
+            simTime_t nextTime;            // Earliest pending event, published at each window boundary
+            simTime_t now;
+            uint64_t processedEvents;
+            Partition(double width) : queue(width), nextTime(0), now(0), processedEvents(0) {}
+        };
+
+        size_t numThreads;
+        simTime_t lookahead;
+        std::vector<std::unique_ptr<Partition>> partitions;
+        SpinBarrier barrier;
+
+        size_t partitionOf(minerId_t miner) const;
+        /*
+            Queues an event on its receiver's partition, splitting a multicast into one per partition it reaches
+        */
+        void deliver(Partition & partition, Event && event);
+        void deliverOne(Partition & partition, Event && event);
+        void mergeInbox(Partition & partition);
+        void worker(size_t index, simTime_t endTime);
+
+    public:
+        ParallelScheduler(std::vector<Miner> & miners, RandomStream rng, size_t numThreads);
+        void run(simTime_t endTime) override;
+};
+
+#endif
@@ -0,0 +1,51 @@
+#include "random.hpp"
+
+RandomStream::RandomStream(uint64_t seed) {
+    // splitmix64 expands the seed so that nearby seeds give unrelated states
+    for (uint64_t & word : state) {
+        uint64_t z = (seed += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        word = z ^ (z >> 31);
+    }
+}
+
+void RandomStream::jump() {
+    static const uint64_t JUMP[] = { 0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL, 0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL };
+    uint64_t jumped[4] = { 0, 0, 0, 0 };
+    for (uint64_t word : JUMP) {
+        for (int bit = 0; bit < 64; bit++) {
+            if (word & (1ULL << bit)) {
+                for (int i = 0; i < 4; i++) {
+                    jumped[i] ^= state[i];
+                }
+            }
+            (*this)();
+        }
+    }
+    std::copy(jumped, jumped + 4, state);
+}
+
+RandomStream RandomStream::split() {
+    RandomStream stream = *this;
+    jump();
+    return stream;
+}
+
+double RandomStream::uniform(double a, double b) {
+    return a + (b - a) * uniform();
+}
+
+double RandomStream::exponential(double mean) {
+    // 1 - u lies in (0, 1], keeping log() finite
+    return -mean * std::log(1.0 - uniform());
+}
+
+void RandomStream::fillExponential(double * out, size_t count, double mean) {
+    for (size_t i = 0; i < count; i++) {
+        out[i] = 1.0 - uniform();
+    }
+    for (size_t i = 0; i < count; i++) {
+        out[i] = -mean * std::log(out[i]);
+    }
+}
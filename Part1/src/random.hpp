@@ -0,0 +1,57 @@
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include "def.hpp"
+
+/*
+    xoshiro256** pseudo random stream (Blackman & Vigna)
+    1) Seeded through splitmix64 from one 64-bit run seed, so a run is reproducible bit for bit
+    2) jump() advances the stream by 2^128 draws; split() hands out the current position and jumps,
+       which gives every miner (and the network) its own non-overlapping stream from the same seed
+    3) Satisfies UniformRandomBitGenerator, so it can drive std::shuffle and the std distributions
+*/
+class RandomStream {
+    private:
+        uint64_t state[4];
+
+        static uint64_t rotl(uint64_t x, int k) {
+            return (x << k) | (x >> (64 - k));
+        }
+
+    public:
+        using result_type = uint64_t;
+
+        RandomStream(uint64_t seed = 0);
+
+        static constexpr result_type min() { return 0; }
+        static constexpr result_type max() { return UINT64_MAX; }
+
+        result_type operator()() {
+            uint64_t result = rotl(state[1] * 5, 7) * 9;
+            uint64_t t = state[1] << 17;
+            state[2] ^= state[0];
+            state[3] ^= state[1];
+            state[1] ^= state[2];
+            state[0] ^= state[3];
+            state[2] ^= t;
+            state[3] = rotl(state[3], 45);
+            return result;
+        }
+
+        void jump();
+        RandomStream split();
+
+        // Uniform in [0, 1) with 53 bits of precision
+        double uniform() {
+            return ((*this)() >> 11) * 0x1.0p-53;
+        }
+        double uniform(double a, double b);
+        double exponential(double mean);
+
+        /*
+            Batch sampling: draws all the raw bits first, then transforms the whole buffer in a tight loop
+        */
+        void fillExponential(double * out, size_t count, double mean);
+};
+
+#endif
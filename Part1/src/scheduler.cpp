@@ -0,0 +1,143 @@
+#include "scheduler.hpp"
+#include "trace.hpp"
+
+static std::vector<std::vector<minerId_t>> adjacencyOf(const std::vector<Miner> & miners) {
+    std::vector<std::vector<minerId_t>> adjacency;
+    adjacency.reserve(miners.size());
+    for (const Miner & miner : miners) {
+        adjacency.push_back(miner.getNeighbours());
+    }
+    return adjacency;
+}
+
+Scheduler::Scheduler(std::vector<Miner> & miners, RandomStream rng):
+    miners(miners),
+    network(adjacencyOf(miners), rng),
+    now(0),
+    processedEvents(0),
+    wallSeconds(0)
+{}
+
+simTime_t Scheduler::minLinkLatency() const {
+    return network.minLatency();
+}
+
+void Scheduler::route(Event & event) {
+    size_t bytes;
+    switch (event.type) {
+    case EventType::SEND_BROADCAST_BLOCK:
+        event.type = EventType::RECEIVE_BROADCAST_BLOCK;
+        bytes = event.block->dataSize();
+        break;
+    case EventType::SEND_BROADCAST_TRANSACTION:
+        event.type = EventType::RECEIVE_BROADCAST_TRANSACTION;
+        bytes = event.transaction->dataSize();
+        break;
+    case EventType::SEND_BLOCK_HEADER:
+        event.type = EventType::RECEIVE_BLOCK_HEADER;
+        bytes = HEADER_BYTES;
+        break;
+    case EventType::SEND_GET_COMPACT_BLOCK:
+        event.type = EventType::RECEIVE_GET_COMPACT_BLOCK;
+        bytes = INV_BYTES;
+        break;
+    case EventType::SEND_COMPACT_BLOCK:
+        event.type = EventType::RECEIVE_COMPACT_BLOCK;
+        bytes = event.payloadSize;
+        break;
+    case EventType::SEND_GET_BLOCK_TXNS:
+        // The index list of the request is a few bytes, sent as an inv; payloadSize is what it asks for
+        event.type = EventType::RECEIVE_GET_BLOCK_TXNS;
+        bytes = INV_BYTES;
+        break;
+    case EventType::SEND_BLOCK_TXNS:
+        event.type = EventType::RECEIVE_BLOCK_TXNS;
+        bytes = event.payloadSize;
+        break;
+    default:
+        return;
+    }
+    if (event.peers == 0) {
+        event.timestamp += network.send(event.owner, event.receiver, bytes, event.timestamp);
+        return;
+    }
+
+    // Multicast: every link is reserved now, in neighbour order, the deliveries then wait in one event
+    const std::vector<minerId_t> & neighbours = miners[event.owner].getNeighbours();
+    std::vector<Event::Arrival> arrivals;
+    for (uint64_t peers = event.peers; peers != 0; peers &= peers - 1) {
+        minerId_t peer = neighbours[__builtin_ctzll(peers)];
+        arrivals.push_back(Event::Arrival{event.timestamp + network.send(event.owner, peer, bytes, event.timestamp), peer});
+    }
+    std::stable_sort(arrivals.begin(), arrivals.end(), [](const Event::Arrival & a, const Event::Arrival & b) {
+        return a.time > b.time;
+    });
+    event.peers = 0;
+    event.setArrivals(std::move(arrivals));
+}
+
+void Scheduler::dispatch(Event & event, simTime_t time, std::vector<Event> & newEvents) {
+    METRIC_EVENT(event.type);
+    if (Trace::enabled()) {
+        Trace::delivery(event, time);
+    }
+    Miner & miner = miners[event.receiver];
+    for (Event & newEvent : miner.receiveEvent(event)) {
+        route(newEvent);
+        newEvents.push_back(std::move(newEvent));
+    }
+    for (Event & newEvent : miner.getEventList(time)) {
+        route(newEvent);
+        newEvents.push_back(std::move(newEvent));
+    }
+}
+
+simTime_t Scheduler::getTime() const {
+    return now;
+}
+
+uint64_t Scheduler::getProcessedEvents() const {
+    return processedEvents;
+}
+
+double Scheduler::getWallSeconds() const {
+    return wallSeconds;
+}
+
+double Scheduler::getEventsPerSecond() const {
+    return wallSeconds > 0 ? processedEvents / wallSeconds : 0;
+}
+
+SequentialScheduler::SequentialScheduler(std::vector<Miner> & miners, RandomStream rng):
+    Scheduler(miners, rng),
+    queue(TXN_INTER_ARRIVAL_TIME / std::max<size_t>(miners.size(), 1))
+{}
+
+void SequentialScheduler::run(simTime_t endTime) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<Event> newEvents;
+
+    for (Miner & miner : miners) {
+        newEvents = miner.getEventList(now);
+        for (Event & event : newEvents) {
+            route(event);
+            queue.push(event.timestamp, std::move(event));
+        }
+    }
+
+    while (!queue.empty() && queue.topTime() <= endTime) {
+        Event event = queue.pop(&now);
+        if (!event.arrivals.empty()) {
+            Event rest = event.nextDelivery();
+            queue.push(rest.timestamp, std::move(rest));
+        }
+        newEvents.clear();
+        dispatch(event, now, newEvents);
+        for (Event & newEvent : newEvents) {
+            queue.push(newEvent.timestamp, std::move(newEvent));
+        }
+        processedEvents++;
+    }
+
+    wallSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
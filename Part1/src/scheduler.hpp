@@ -0,0 +1,71 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "miner.hpp"
+#include "calendarQueue.hpp"
+#include "network.hpp"
+#include "metrics.hpp"
+
+/*
+    Global discrete-event loop (the "main thread" of design.md)
+    1) Pulls newly scheduled events out of every miner through Miner::getEventList
+    2) Pops events in timestamp order and hands them to Event::receiver through Miner::receiveEvent
+    3) SEND_BROADCAST_* events returned by a miner are turned into RECEIVE_BROADCAST_* events on the
+       peer, delayed by the link latency of the Network model; a multicast stays one queue entry for all its
+       peers, requeued at its next arrival each time it is popped
+    The base class owns what every execution strategy shares: routing, dispatching and run statistics
+*/
+class Scheduler {
+    protected:
+        std::vector<Miner> & miners;
+        Network network;
+        simTime_t now;
+        uint64_t processedEvents;
+        double wallSeconds;
+
+        /*
+            Turns SEND_* events into the matching RECEIVE_* event on the peer, delayed by the link latency; a multicast
+            reserves all its links and becomes its earliest delivery, carrying the others (Event::arrivals)
+            Only touches the sender's links, so partitions may route their own miners' events concurrently
+        */
+        void route(Event & event);
+
+        /*
+            Processes the event on its receiver and appends every resulting (routed) event to newEvents
+        */
+        void dispatch(Event & event, simTime_t time, std::vector<Event> & newEvents);
+
+    public:
+        Scheduler(std::vector<Miner> & miners, RandomStream rng);
+        virtual ~Scheduler() = default;
+
+        /*
+            Runs the simulation until no event is left or the next event is past endTime
+        */
+        virtual void run(simTime_t endTime) = 0;
+
+        /*
+            Smallest delay any message can take between two miners (the smallest propagation delay of the graph),
+            the lookahead of parallel execution
+        */
+        simTime_t minLinkLatency() const;
+
+        simTime_t getTime() const;
+        uint64_t getProcessedEvents() const;
+        double getWallSeconds() const;
+        double getEventsPerSecond() const;
+};
+
+/*
+    Single-threaded execution over one calendar queue
+*/
+class SequentialScheduler : public Scheduler {
+    private:
+        CalendarQueue<Event> queue;
+
+    public:
+        SequentialScheduler(std::vector<Miner> & miners, RandomStream rng);
+        void run(simTime_t endTime) override;
+};
+
+#endif
@@ -0,0 +1,57 @@
+#include "seenFilter.hpp"
+
+SeenFilter::SeenFilter(size_t capacity) : current(0), inserted(0), capacity(std::max<size_t>(capacity, 1)) {
+    size_t bits = 64;
+    while (bits < this->capacity * BITS_PER_KEY) {
+        bits <<= 1;
+    }
+    mask = bits - 1;
+    generations[0].assign(bits / 64, 0);
+    generations[1].assign(bits / 64, 0);
+}
+
+void SeenFilter::hashes(uint64_t id, minerId_t peer, uint64_t & h1, uint64_t & h2) {
+    // splitmix64 over the packed key, the two halves seed double hashing
+    uint64_t x = id * 0x9e3779b97f4a7c15ULL ^ (peer + 1) * 0xc2b2ae3d27d4eb4fULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    h1 = x;
+    h2 = (x >> 32 | x << 32) | 1;
+}
+
+bool SeenFilter::test(const std::vector<uint64_t> & bits, uint64_t h1, uint64_t h2) const {
+    for (size_t i = 0; i < HASHES; i++) {
+        uint64_t bit = (h1 + i * h2) & mask;
+        if (!(bits[bit >> 6] >> (bit & 63) & 1)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SeenFilter::contains(uint64_t id, minerId_t peer) const {
+    uint64_t h1, h2;
+    hashes(id, peer, h1, h2);
+    return test(generations[current], h1, h2) || test(generations[current ^ 1], h1, h2);
+}
+
+bool SeenFilter::insert(uint64_t id, minerId_t peer) {
+    uint64_t h1, h2;
+    hashes(id, peer, h1, h2);
+    if (test(generations[current], h1, h2) || test(generations[current ^ 1], h1, h2)) {
+        return false;
+    }
+    if (inserted == capacity) {
+        current ^= 1;
+        std::fill(generations[current].begin(), generations[current].end(), 0);
+        inserted = 0;
+    }
+    std::vector<uint64_t> & bits = generations[current];
+    for (size_t i = 0; i < HASHES; i++) {
+        uint64_t bit = (h1 + i * h2) & mask;
+        bits[bit >> 6] |= 1ULL << (bit & 63);
+    }
+    inserted++;
+    return true;
+}
@@ -0,0 +1,41 @@
+#ifndef SEEN_FILTER_H
+#define SEEN_FILTER_H
+
+#include "def.hpp"
+
+/*
+    Rolling Bloom filter remembering which ids a miner has seen, and which peers are known to have them (gossip dedup)
+    1) Keys are (id, peer) pairs, ANY_PEER standing for "seen at all"
+    2) Two generations of capacity insertions each: once the current one is full the older one is cleared and
+       becomes current, so a key is remembered for at least capacity insertions and memory never grows
+    3) False positives are possible (about 4e-5 per query at full load), false negatives within the window are not
+*/
+class SeenFilter {
+    public:
+        static const minerId_t ANY_PEER = std::numeric_limits<minerId_t>::max();
+
+    private:
+        static const size_t HASHES = 8;
+        static const size_t BITS_PER_KEY = 24;
+
+        std::vector<uint64_t> generations[2];
+        size_t current;
+        size_t inserted;        // Insertions into the current generation
+        size_t capacity;
+        uint64_t mask;          // Bits per generation - 1
+
+        static void hashes(uint64_t id, minerId_t peer, uint64_t & h1, uint64_t & h2);
+        bool test(const std::vector<uint64_t> & bits, uint64_t h1, uint64_t h2) const;
+
+    public:
+        SeenFilter(size_t capacity);
+
+        bool contains(uint64_t id, minerId_t peer = ANY_PEER) const;
+
+        /*
+            Returns false if the key was (probably) there already
+        */
+        bool insert(uint64_t id, minerId_t peer = ANY_PEER);
+};
+
+#endif
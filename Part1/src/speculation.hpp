@@ -0,0 +1,50 @@
+#ifndef SPECULATION_H
+#define SPECULATION_H
+
+#include "def.hpp"
+
+/*
+    Side effects (metrics, log records, trace records) of events the Time Warp scheduler runs speculatively
+    1) Outside optimistic execution an effect applies at once
+    2) While a speculative event runs, its effects are queued on the event's record and applied when it commits
+       (GVT has passed it); a rolled back event drops them with its record
+    3) Coast forward re-runs events whose effects are already queued, their effects are dropped
+    The state is per thread, metrics, logger and trace check it before recording anything
+*/
+class Speculation {
+    public:
+        using Effects = std::vector<std::function<void()>>;
+
+        static void defer(Effects * effects) {
+            queue = effects;
+            dropping = false;
+        }
+
+        static void drop() {
+            queue = nullptr;
+            dropping = true;
+        }
+
+        static void stop() {
+            queue = nullptr;
+            dropping = false;
+        }
+
+        /*
+            Returns true if the effect was queued or dropped, the caller applies it itself otherwise
+        */
+        template <typename Effect>
+        static bool capture(Effect && effect) {
+            if (queue) {
+                queue->emplace_back(std::forward<Effect>(effect));
+                return true;
+            }
+            return dropping;
+        }
+
+    private:
+        static inline thread_local Effects * queue = nullptr;
+        static inline thread_local bool dropping = false;
+};
+
+#endif
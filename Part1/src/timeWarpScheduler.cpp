@@ -0,0 +1,249 @@
+#include "timeWarpScheduler.hpp"
+
+// Events an LP processes between two checkpoints, trades checkpoint copies against coast forward work
+static const size_t CHECKPOINT_INTERVAL = 32;
+// How far past GVT an LP may run speculatively, in lookaheads; bounds the rollback depth and the memory held
+// for it, with flooding relay almost every message crosses partitions so wide windows mostly buy rollbacks
+static const double OPTIMISM_WINDOW = 10;
+// Events a worker processes between two GVT rounds
+static const size_t ROUND_EVENTS = 4096;
+
+static const simTime_t NEVER = std::numeric_limits<simTime_t>::infinity();
+
+bool TimeWarpScheduler::Key::operator<(const Key & other) const {
+    if (time != other.time) {
+        return time < other.time;
+    }
+    return sender < other.sender || (sender == other.sender && serial < other.serial);
+}
+
+TimeWarpScheduler::TimeWarpScheduler(std::vector<Miner> & miners, RandomStream rng, size_t numThreads):
+    Scheduler(miners, rng),
+    numThreads(std::max<size_t>(1, std::min(numThreads, miners.size()))),
+    processes(miners.size()),
+    barrier(this->numThreads),
+    rolledBackEvents(0)
+{
+    for (size_t i = 0; i < this->numThreads; i++) {
+        partitions.push_back(std::make_unique<Partition>());
+    }
+}
+
+size_t TimeWarpScheduler::partitionOf(minerId_t miner) const {
+    return miner % numThreads;
+}
+
+void TimeWarpScheduler::send(Partition & partition, Message && message) {
+    Partition & destination = *partitions[partitionOf(message.receiver)];
+    if (&destination == &partition) {
+        partition.local.push_back(std::move(message));
+    } else {
+        partition.sentMin = std::min(partition.sentMin, message.key.time);
+        destination.inbox.push(std::move(message));
+    }
+}
+
+void TimeWarpScheduler::receive(Partition & partition) {
+    partition.inbox.drain([&partition](Message && message) { partition.local.push_back(std::move(message)); });
+    // Handling a message may roll an LP back and queue more (anti-)messages for this partition
+    while (!partition.local.empty()) {
+        Message message = std::move(partition.local.front());
+        partition.local.pop_front();
+        handle(partition, std::move(message));
+    }
+}
+
+void TimeWarpScheduler::handle(Partition & partition, Message && message) {
+    LogicalProcess & process = processes[message.receiver];
+    // Producers keep their order, so an anti-message always finds its event either pending or processed
+    if (!process.processed.empty() && !(process.processed.back().key < message.key)) {
+        rollback(partition, message.receiver, message.key);
+    }
+    if (message.event) {
+        process.pending.emplace(message.key, std::move(*message.event));
+    } else {
+        process.pending.erase(message.key);
+    }
+}
+
+void TimeWarpScheduler::execute(Partition & partition, minerId_t miner) {
+    LogicalProcess & process = processes[miner];
+    auto next = process.pending.begin();
+    if (process.sinceCheckpoint >= CHECKPOINT_INTERVAL) {
+        process.checkpoints.push_back(Checkpoint{next->first, miners[miner], network.saveSender(miner)});
+        process.sinceCheckpoint = 0;
+    }
+    process.processed.push_back(Processed{next->first, std::move(next->second), {}});
+    process.pending.erase(next);
+    process.sinceCheckpoint++;
+
+    Processed & record = process.processed.back();
+    partition.newEvents.clear();
+    Speculation::defer(&record.effects);
+    dispatch(record.event, record.key.time, partition.newEvents);
+    Speculation::stop();
+
+    auto post = [&](Event && event) {
+        Key key{event.timestamp, miner, process.nextSerial++};
+        minerId_t receiver = event.receiver;
+        process.sent.push_back(Sent{record.key, key, receiver});
+        send(partition, Message{key, receiver, std::move(event)});
+    };
+    for (Event & event : partition.newEvents) {
+        if (event.arrivals.empty()) {
+            post(std::move(event));
+            continue;
+        }
+        // Every receiver is a process of its own, so a multicast goes out as one message per delivery
+        std::vector<Event::Arrival> arrivals = event.takeArrivals();
+        for (auto arrival = arrivals.rbegin(); arrival != arrivals.rend(); arrival++) {
+            Event delivery = event.forPeer(arrival->receiver);
+            delivery.timestamp = arrival->time;
+            post(std::move(delivery));
+        }
+    }
+}
+
+void TimeWarpScheduler::rollback(Partition & partition, minerId_t miner, const Key & target) {
+    LogicalProcess & process = processes[miner];
+
+    // Undo everything from the target on and cancel what it sent, newest first
+    while (!process.processed.empty() && !(process.processed.back().key < target)) {
+        Processed & record = process.processed.back();
+        process.pending.emplace(record.key, std::move(record.event));
+        process.processed.pop_back();
+        partition.rolledBackEvents++;
+    }
+    while (!process.sent.empty() && !(process.sent.back().cause < target)) {
+        const Sent & sent = process.sent.back();
+        send(partition, Message{sent.key, sent.receiver, std::nullopt});
+        process.sent.pop_back();
+    }
+
+    // Restore the latest state strictly before the target and coast forward to it; a checkpoint is only kept
+    // while the event it was taken for stays processed, otherwise an event arriving just before that key
+    // would not be seen as a straggler and the checkpoint would silently miss it
+    while (process.checkpoints.size() > 1 && !(process.checkpoints.back().key < target)) {
+        process.checkpoints.pop_back();
+    }
+    const Checkpoint & checkpoint = process.checkpoints.back();
+    miners[miner] = checkpoint.miner;
+    network.restoreSender(miner, checkpoint.links);
+    process.sinceCheckpoint = 0;
+
+    auto first = std::lower_bound(process.processed.begin(), process.processed.end(), checkpoint.key,
+        [](const Processed & record, const Key & key) { return record.key < key; });
+    for (auto record = first; record != process.processed.end(); record++) {
+        partition.newEvents.clear();
+        Speculation::drop();
+        dispatch(record->event, record->key.time, partition.newEvents);
+        Speculation::stop();
+        process.sinceCheckpoint++;
+    }
+}
+
+void TimeWarpScheduler::collectFossils(Partition & partition, size_t index, simTime_t gvt, bool final) {
+    for (size_t miner = index; miner < miners.size(); miner += numThreads) {
+        LogicalProcess & process = processes[miner];
+        // Nothing rolls back before gvt, so the latest checkpoint before it is the oldest one still needed
+        while (process.checkpoints.size() > 1 && process.checkpoints[1].key.time < gvt) {
+            process.checkpoints.pop_front();
+        }
+        while (!process.processed.empty() && (final || process.processed.front().key < process.checkpoints.front().key)) {
+            partition.now = std::max(partition.now, process.processed.front().key.time);
+            partition.committedEvents++;
+            for (const auto & effect : process.processed.front().effects) {
+                effect();
+            }
+            process.processed.pop_front();
+        }
+        while (!process.sent.empty() && (final || process.sent.front().cause.time < gvt)) {
+            process.sent.pop_front();
+        }
+    }
+}
+
+void TimeWarpScheduler::worker(size_t index, simTime_t endTime) {
+    Partition & partition = *partitions[index];
+    partition.sentMin = NEVER;
+
+    for (size_t miner = index; miner < miners.size(); miner += numThreads) {
+        LogicalProcess & process = processes[miner];
+        for (Event & event : miners[miner].getEventList(0)) {
+            route(event);
+            Key key{event.timestamp, miner, process.nextSerial++};
+            minerId_t receiver = event.receiver;
+            send(partition, Message{key, receiver, std::move(event)});
+        }
+        process.checkpoints.push_back(Checkpoint{Key{-NEVER, 0, 0}, miners[miner], network.saveSender(miner)});
+    }
+
+    simTime_t gvt = 0;
+    while (true) {
+        simTime_t limit = std::min(endTime, gvt + OPTIMISM_WINDOW * minLinkLatency());
+        for (size_t i = 0; i < ROUND_EVENTS; i++) {
+            receive(partition);
+            // Earliest pending event among this partition's LPs within the optimism window
+            minerId_t next = miners.size();
+            simTime_t nextTime = NEVER;
+            for (size_t miner = index; miner < miners.size(); miner += numThreads) {
+                const auto & pending = processes[miner].pending;
+                if (!pending.empty() && pending.begin()->first.time <= limit && pending.begin()->first.time < nextTime) {
+                    next = miner;
+                    nextTime = pending.begin()->first.time;
+                }
+            }
+            if (next == miners.size()) {
+                break;
+            }
+            execute(partition, next);
+        }
+
+        // GVT round: after the first barrier every message sent before it sits in some inbox, messages sent
+        // while handling those are accounted for by their sender through sentMin
+        barrier.wait();
+        partition.sentMin = NEVER;
+        receive(partition);
+        partition.localMin = partition.sentMin;
+        for (size_t miner = index; miner < miners.size(); miner += numThreads) {
+            if (!processes[miner].pending.empty()) {
+                partition.localMin = std::min(partition.localMin, processes[miner].pending.begin()->first.time);
+            }
+        }
+        barrier.wait();
+
+        gvt = NEVER;
+        for (const auto & other : partitions) {
+            gvt = std::min(gvt, other->localMin);
+        }
+        collectFossils(partition, index, gvt, gvt > endTime);
+        if (gvt > endTime) {
+            break;
+        }
+    }
+}
+
+void TimeWarpScheduler::run(simTime_t endTime) {
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < numThreads; i++) {
+        threads.emplace_back(&TimeWarpScheduler::worker, this, i, endTime);
+    }
+    for (std::thread & thread : threads) {
+        thread.join();
+    }
+
+    for (const auto & partition : partitions) {
+        processedEvents += partition->committedEvents;
+        rolledBackEvents += partition->rolledBackEvents;
+        partition->committedEvents = 0;
+        partition->rolledBackEvents = 0;
+        now = std::max(now, partition->now);
+    }
+    wallSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+uint64_t TimeWarpScheduler::getRolledBackEvents() const {
+    return rolledBackEvents;
+}
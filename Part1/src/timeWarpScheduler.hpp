@@ -0,0 +1,102 @@
+#ifndef TIME_WARP_SCHEDULER_H
+#define TIME_WARP_SCHEDULER_H
+
+#include "scheduler.hpp"
+#include "mpscQueue.hpp"
+#include "barrier.hpp"
+
+/*
+    Optimistic parallel execution (Time Warp)
+    1) Every miner is a logical process (LP) that runs its events speculatively, without waiting for the other
+       miners, so the available parallelism does not shrink with the link latency the way conservative windows do
+    2) An LP saves a checkpoint (a full copy of its Miner and of its link stream) every CHECKPOINT_INTERVAL events;
+       a straggler (an event older than one already processed) restores the latest checkpoint before it and
+       re-runs the events in between (coast forward); the checkpoint holds the miner's id counter too, so they draw
+       the same ids, and their output is discarded as it was already sent and is still valid
+    3) Events processed from the straggler on go back to the pending set and everything they sent is cancelled
+       by an anti-message, which annihilates the event if still pending or rolls the receiver back otherwise
+    4) Worker threads periodically meet at a barrier to compute the global virtual time (GVT), the earliest time
+       any LP can still roll back to; checkpoints, processed events and send logs older than it are reclaimed
+    5) Metrics, log and trace records of an event are held back until it commits (speculation.hpp): rolled back
+       events leave none and coast forward adds none
+    Events are ordered by (timestamp, sender, serial) instead of arrival, so a re-execution sees the same order
+*/
+class TimeWarpScheduler : public Scheduler {
+    private:
+        struct Key {
+            simTime_t time;
+            minerId_t sender;
+            uint64_t serial;        // Per-sender message counter
+            bool operator<(const Key & other) const;
+        };
+
+        struct Message {
+            Key key;
+            minerId_t receiver;
+            std::optional<Event> event;     // Empty for an anti-message
+        };
+
+        struct Processed {
+            Key key;
+            Event event;
+            Speculation::Effects effects;   // Applied when the event commits
+        };
+
+        struct Sent {
+            Key cause;                      // Event whose processing sent the message
+            Key key;
+            minerId_t receiver;
+        };
+
+        struct Checkpoint {
+            Key key;                        // State right before the event with this key is processed
+            Miner miner;
+            Network::SenderState links;
+        };
+
+        struct LogicalProcess {
+            std::map<Key, Event> pending;
+            std::deque<Processed> processed;
+            std::deque<Sent> sent;
+            std::deque<Checkpoint> checkpoints;
+            uint64_t nextSerial = 0;
+            size_t sinceCheckpoint = 0;
+        };
+
+        struct alignas(64) Partition {
+            MpscQueue<Message> inbox;
+            std::deque<Message> local;      // Messages between LPs of this partition
+            std::vector<Event> newEvents;
+            simTime_t sentMin;              // Earliest message sent to another partition since the GVT round started
+            simTime_t localMin;             // Published at each GVT round
+            simTime_t now = 0;
+            uint64_t committedEvents = 0;
+            uint64_t rolledBackEvents = 0;
+        };
+
+        size_t numThreads;
+        std::vector<LogicalProcess> processes;
+        std::vector<std::unique_ptr<Partition>> partitions;
+        SpinBarrier barrier;
+        uint64_t rolledBackEvents;
+
+        size_t partitionOf(minerId_t miner) const;
+        void send(Partition & partition, Message && message);
+        void receive(Partition & partition);
+        void handle(Partition & partition, Message && message);
+        void execute(Partition & partition, minerId_t miner);
+        void rollback(Partition & partition, minerId_t miner, const Key & target);
+        void collectFossils(Partition & partition, size_t index, simTime_t gvt, bool final);
+        void worker(size_t index, simTime_t endTime);
+
+    public:
+        TimeWarpScheduler(std::vector<Miner> & miners, RandomStream rng, size_t numThreads);
+        void run(simTime_t endTime) override;
+
+        /*
+            Events that were processed speculatively and later undone
+        */
+        uint64_t getRolledBackEvents() const;
+};
+
+#endif
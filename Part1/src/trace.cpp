@@ -0,0 +1,137 @@
+#include "trace.hpp"
+#include "speculation.hpp"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+
+    const size_t CHUNK_BYTES = TRACE_CHUNK_RECORDS * sizeof(TraceRecord);
+
+    struct Cursor {
+        TraceRecord * chunk = nullptr;
+        size_t used = 0;
+        uint64_t generation = 0;    // Trace the chunk belongs to, a cursor left from an earlier trace is stale
+    };
+
+    std::mutex fileMutex;
+    int fd = -1;
+    uint64_t chunks = 0;
+    uint64_t generation = 0;
+    bool failed = false;        // A chunk could not be claimed, reported once
+    std::vector<TraceRecord *> mappings;
+
+    TraceRecord * claimChunk() {
+        std::lock_guard<std::mutex> lock(fileMutex);
+        if (failed || fd < 0) {
+            return nullptr;
+        }
+        off_t offset = TRACE_HEADER_BYTES + chunks * CHUNK_BYTES;
+        void * mapping = MAP_FAILED;
+        if (ftruncate(fd, offset + CHUNK_BYTES) == 0) {
+            mapping = mmap(nullptr, CHUNK_BYTES, PROT_READ | PROT_WRITE, MAP_SHARED, fd, offset);
+        }
+        if (mapping == MAP_FAILED) {
+            std::cerr << "Error extending trace file: " << std::strerror(errno) << ", tracing stopped after "
+                      << chunks << " chunks" << std::endl;
+            failed = true;
+            return nullptr;
+        }
+        chunks++;
+        mappings.push_back(static_cast<TraceRecord *>(mapping));
+        return mappings.back();
+    }
+}
+
+std::atomic<bool> Trace::running{false};
+
+bool Trace::start(const std::string & path) {
+    fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        std::cerr << "Error opening trace file: " << path << std::endl;
+        return false;
+    }
+    chunks = 0;
+    failed = false;
+    generation++;
+    running.store(true, std::memory_order_release);
+    return true;
+}
+
+void Trace::stop() {
+    running.store(false);
+    std::lock_guard<std::mutex> lock(fileMutex);
+    if (fd < 0) {
+        return;
+    }
+    for (TraceRecord * mapping : mappings) {
+        munmap(mapping, CHUNK_BYTES);
+    }
+    mappings.clear();
+
+    TraceHeader header{};
+    std::copy(TRACE_MAGIC, TRACE_MAGIC + 8, header.magic);
+    header.version = TRACE_VERSION;
+    header.recordSize = sizeof(TraceRecord);
+    header.chunkRecords = TRACE_CHUNK_RECORDS;
+    header.chunks = chunks;
+    if (pwrite(fd, &header, sizeof(header), 0) != sizeof(header)) {
+        std::cerr << "Error writing trace header" << std::endl;
+    }
+    close(fd);
+    fd = -1;
+}
+
+void Trace::record(const TraceRecord & record) {
+    if (Speculation::capture([record] { Trace::record(record); })) {
+        return;
+    }
+    thread_local Cursor cursor;
+    if (cursor.generation != generation || cursor.used == TRACE_CHUNK_RECORDS || !cursor.chunk) {
+        cursor.chunk = claimChunk();
+        cursor.used = 0;
+        cursor.generation = generation;
+        if (!cursor.chunk) {
+            // The chunks written so far stay readable, stop() still completes the file
+            running.store(false);
+            return;
+        }
+    }
+    cursor.chunk[cursor.used++] = record;
+}
+
+void Trace::delivery(const Event & event, simTime_t time) {
+    TraceRecord record{};
+    record.time = time;
+    record.id = event.block ? event.block->id : event.transaction ? event.transaction->id : 0;
+    record.aux = event.block ? event.block->parent_id : 0;
+    record.miner = event.receiver;
+    record.peer = event.owner;
+    record.kind = TraceKind::DELIVERY;
+    record.eventType = static_cast<uint16_t>(event.type);
+    Trace::record(record);
+}
+
+void Trace::blockAccepted(minerId_t miner, const Block & block, simTime_t time) {
+    TraceRecord record{};
+    record.time = time;
+    record.id = block.id;
+    record.aux = block.parent_id;
+    record.miner = miner;
+    record.peer = miner;
+    record.kind = TraceKind::BLOCK_ACCEPTED;
+    Trace::record(record);
+}
+
+void Trace::reorg(minerId_t miner, blockId_t tip, uint64_t depth, simTime_t time) {
+    TraceRecord record{};
+    record.time = time;
+    record.id = tip;
+    record.aux = depth;
+    record.miner = miner;
+    record.peer = miner;
+    record.kind = TraceKind::REORG;
+    Trace::record(record);
+}
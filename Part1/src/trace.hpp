@@ -0,0 +1,75 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "def.hpp"
+#include "event.hpp"
+
+enum class TraceKind : uint16_t {
+    EMPTY,              // Unused slot at the end of a chunk
+    DELIVERY,           // An event processed by a miner: id is its block / transaction, aux the block's parent
+    BLOCK_ACCEPTED,     // A block attached to a miner's tree: aux is its parent
+    REORG               // A miner's longest chain switched to the block id: aux is the number of blocks disconnected
+};
+
+/*
+    Fixed-size trace record, written as is to the file
+*/
+struct TraceRecord {
+    simTime_t time;
+    uint64_t id;
+    uint64_t aux;
+    uint32_t miner;         // Miner processing the event / owning the tree
+    uint32_t peer;          // Sender of a delivered event, the miner itself otherwise
+    TraceKind kind;
+    uint16_t eventType;     // EventType of a DELIVERY
+    uint32_t reserved;
+};
+
+static_assert(sizeof(TraceRecord) == 40, "Trace records are 40 bytes on disk");
+static_assert(std::is_trivially_copyable<TraceRecord>::value, "Trace records are copied as raw bytes");
+
+/*
+    Trace file layout: a TRACE_HEADER_BYTES header page, then chunks of TRACE_CHUNK_RECORDS records
+*/
+struct TraceHeader {
+    char magic[8];              // "SIMTRACE"
+    uint32_t version;
+    uint32_t recordSize;
+    uint64_t chunkRecords;
+    uint64_t chunks;            // Chunks in the file, filled in when the trace is closed
+};
+
+static const char TRACE_MAGIC[8] = {'S', 'I', 'M', 'T', 'R', 'A', 'C', 'E'};
+static const uint32_t TRACE_VERSION = 1;
+static const size_t TRACE_HEADER_BYTES = 4096;
+static const size_t TRACE_CHUNK_RECORDS = 1 << 16;      // 2.5 MB, a whole number of pages
+
+/*
+    Binary event trace written through memory-mapped chunks of one file
+    1) Each thread claims a whole chunk at a time (the only synchronised step: the file is extended and the
+       chunk mapped under a mutex) and then appends records to it with plain stores, no system call per record
+    2) Records of different threads therefore sit in different chunks, not in time order; readers sort or
+       aggregate by time themselves, and skip EMPTY slots left at the end of the last chunks
+    3) Nothing is recorded unless start() was called; records of speculative events are written when the event
+       commits (speculation.hpp), so rolled back and re-run events appear once
+*/
+class Trace {
+    public:
+        static bool start(const std::string & path);
+        static void stop();
+
+        static bool enabled() {
+            return running.load(std::memory_order_relaxed);
+        }
+
+        static void record(const TraceRecord & record);
+
+        static void delivery(const Event & event, simTime_t time);
+        static void blockAccepted(minerId_t miner, const Block & block, simTime_t time);
+        static void reorg(minerId_t miner, blockId_t tip, uint64_t depth, simTime_t time);
+
+    private:
+        static std::atomic<bool> running;
+};
+
+#endif
@@ -1,22 +1,35 @@
 #include "transaction.hpp"
 
-Transaction::Transaction(txnId_t id, std::vector<Utxo> in_utxos, std::vector<Utxo> out_utxos, TransactionType type) {
+Transaction::Transaction(txnId_t id, const std::vector<Outpoint> & inputs, const std::vector<Utxo> & outputs, TransactionType type) {
+    if ( inputs.size() > MAX_TXN_INPUTS || outputs.size() > MAX_TXN_OUTPUTS ) {
+        throw std::length_error("Transaction::Transaction: too many inputs or outputs");
+    }
     this->id = id;
-    this->in_utxos = in_utxos;
-    this->out_utxos = out_utxos;
     this->type = type;
+    this->inputCount = inputs.size();
+    this->outputCount = outputs.size();
+    std::copy(inputs.begin(), inputs.end(), inputSlots);
+    std::copy(outputs.begin(), outputs.end(), outputSlots);
 }
 
-int Transaction::amount() const {
-    return std::accumulate(out_utxos.begin(), out_utxos.end(), 0, [](int sum, Utxo & utxo) { return sum + utxo.amount; });
+uint64_t Transaction::amount() const {
+    Slice<const Utxo> outs = outputs();
+    return std::accumulate(outs.begin(), outs.end(), (uint64_t) 0, [](uint64_t sum, const Utxo & utxo) { return sum + utxo.amount; });
 }
 
-bool Transaction::isBalanceConsistent() const {
-    return ( type == TransactionType::COINBASE && std::accumulate(out_utxos.begin(), out_utxos.end(), 0, [](int sum, Utxo & utxo) { return sum + utxo.amount; }) == MINING_REWARD) ||
-        (   std::accumulate(in_utxos.begin(), in_utxos.end(), 0, [](int sum, Utxo & utxo) { return sum + utxo.amount; }) ==
-            std::accumulate(out_utxos.begin(), out_utxos.end(), 0, [](int sum, Utxo & utxo) { return sum + utxo.amount; }));
+bool Transaction::isBalanceConsistent(uint64_t inputAmount) const {
+    return ( type == TransactionType::COINBASE && inputCount == 0 && amount() == MINING_REWARD ) ||
+        ( type == TransactionType::NORMAL && inputCount > 0 && amount() == inputAmount );
 }
 
 size_t Transaction::dataSize() const {
-    return sizeof(Transaction) + std::accumulate(in_utxos.begin(), in_utxos.end(), (size_t) 0, [](int sum, Utxo & utxo) { return sum + utxo.dataSize(); }) + std::accumulate(out_utxos.begin(), out_utxos.end(), (size_t) 0, [](int sum, Utxo & utxo) { return sum + utxo.dataSize(); }); 
-}
\ No newline at end of file
+    return dataSize(inputCount, outputCount);
+}
+
+size_t Transaction::dataSize(size_t inputs, size_t outputs) {
+    return sizeof(Transaction) - (MAX_TXN_INPUTS - inputs) * sizeof(Outpoint) - (MAX_TXN_OUTPUTS - outputs) * sizeof(Utxo);
+}
+
+bool Transaction::operator < (const Transaction & other) const {
+    return id < other.id;
+}
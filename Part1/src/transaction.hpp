@@ -9,14 +9,49 @@ enum class TransactionType {
     COINBASE
 };
 
+/*
+    Contiguous run of elements stored inline in a transaction, iterable like the vectors it replaces
+*/
+template <typename T>
+struct Slice {
+    T * first;
+    size_t count;
+
+    T * begin() const { return first; }
+    T * end() const { return first + count; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    T & operator[](size_t index) const { return first[index]; }
+};
+
+/*
+    1) Inputs are the outpoints they spend, their amount and owner live in the output they name (BlockTree resolves it)
+    2) Inputs and outputs are held inline, at most MAX_TXN_INPUTS / MAX_TXN_OUTPUTS of them, so a transaction has no
+       heap member: copying one into a block template or a relayed block is a plain memcpy
+*/
 struct Transaction {
     txnId_t id;
-    std::vector<Utxo> in_utxos, out_utxos;
     TransactionType type;
-    Transaction(txnId_t id, std::vector<Utxo> in_utxos, std::vector<Utxo> out_utxos, TransactionType type);
-    int amount() const;
-    bool isBalanceConsistent() const;
+    uint8_t inputCount, outputCount;
+    Outpoint inputSlots[MAX_TXN_INPUTS];
+    Utxo outputSlots[MAX_TXN_OUTPUTS];
+
+    /* Throws std::length_error past MAX_TXN_INPUTS inputs or MAX_TXN_OUTPUTS outputs */
+    Transaction(txnId_t id, const std::vector<Outpoint> & inputs, const std::vector<Utxo> & outputs, TransactionType type);
+
+    Slice<const Outpoint> inputs() const { return {inputSlots, inputCount}; }
+    Slice<const Utxo> outputs() const { return {outputSlots, outputCount}; }
+    Slice<Utxo> outputs() { return {outputSlots, outputCount}; }
+
+    uint64_t amount() const;
+    bool isBalanceConsistent(uint64_t inputAmount) const;      /* inputAmount: total of the outputs the inputs spend */
     size_t dataSize() const;
+    static size_t dataSize(size_t inputs, size_t outputs);     /* Bytes of a transaction with that many inputs / outputs */
+    bool operator < (const Transaction & other) const;
 };
 
-#endif
\ No newline at end of file
+static_assert(std::is_trivially_copyable<Transaction>::value, "Transaction must stay memcpy-able");
+
+using TransactionPtr = std::shared_ptr<const Transaction>;
+
+#endif
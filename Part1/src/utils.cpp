@@ -1,47 +1,44 @@
 #include "utils.hpp"
 #include <iostream>
 
-// Add these definitions before the Counter methods
-blockId_t Counter::blockIDCount = 0;
-txnId_t Counter::txnIDCount = 0;
+Counter::Counter(minerId_t owner) : next((owner << ID_SEQUENCE_BITS) + 1) {}
 
-blockId_t Counter::getBlockID(){
-    return blockIDCount++;
+blockId_t Counter::getBlockID(uint64_t content){
+    uint64_t sequence = next++;
+    uint64_t mask = (1ULL << ID_SEQUENCE_BITS) - 1;
+    // Never 0 in the low bits, so never the genesis block
+    return (sequence & ~mask) | (combine(sequence, content) % mask + 1);
 }
 
 txnId_t Counter::getTxnID(){
-    return txnIDCount++;
+    return next++;
+}
+
+uint64_t Counter::combine(uint64_t digest, uint64_t value){
+    // splitmix64 finaliser over both words
+    uint64_t z = digest ^ (value + 0x9e3779b97f4a7c15ULL + (digest << 6) + (digest >> 2));
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
 }
 
 
-double getExponentialRandom(double mean) {
+double getExponentialRandom(RandomStream & rng, double mean) {
     if (mean <= 0) {
         throw std::invalid_argument("Mean must be greater than zero.");
     }
 
-    // Create a random device and a random number generator
-    std::random_device rd;
-    std::mt19937 gen(rd());  
-
-    // Create an exponential distribution with lambda = 1/mean
-    std::exponential_distribution<double> distribution(1.0 / mean);
-
-    return distribution(gen);
+    // Exponential with lambda = 1/mean, drawn from the caller's stream
+    return rng.exponential(mean);
 }
 
-double getUniformRandom(double a, double b) {
+double getUniformRandom(RandomStream & rng, double a, double b) {
     if (a >= b) {
         throw std::invalid_argument("Lower bound must be less than upper bound.");
     }
 
-    // Create a random device and a random number generator
-    std::random_device rd;
-    std::mt19937 gen(rd());  
-
-    // Create a uniform distribution between [a, b]
-    std::uniform_real_distribution<double> distribution(a, b);
-
-    return distribution(gen);
+    // Uniform between [a, b), drawn from the caller's stream
+    return rng.uniform(a, b);
 }
 
 bool is_connected(const std::vector<std::unordered_set<int> >  &adj)
@@ -71,7 +68,7 @@ bool is_connected(const std::vector<std::unordered_set<int> >  &adj)
     return count == n;
 }
 
-std::vector<std::vector<int> > generate_graph(int n) {
+std::vector<std::vector<int> > generate_graph(int n, RandomStream & rng) {
     std::vector<std::vector<int> > adj(n);
 
     if (n < 4) {
@@ -96,6 +93,7 @@ std::vector<std::vector<int> > generate_graph(int n) {
 
     bool connected = false;
     while (!connected) {
+        adj.assign(n, std::vector<int>());
         std::vector<int> stubs;
         for (int i = 0; i < n; ++i) {
             for (int j = 0; j < degrees[i]; ++j) {
@@ -103,9 +101,8 @@ std::vector<std::vector<int> > generate_graph(int n) {
             }
         }
 
-        shuffle(stubs.begin(), stubs.end(), std::mt19937(std::random_device()()));
+        shuffle(stubs.begin(), stubs.end(), rng);
 
-        std::vector<std::vector<int> > adj(n);
         std::unordered_set<std::pair<int, int>, pair_hash> edges;
         bool valid = true;
 
@@ -171,7 +168,7 @@ std::vector<std::vector<int> > generate_graph(int n) {
         }
     }
 
-    shuffle(possible_edges.begin(), possible_edges.end(), std::mt19937(std::random_device()()));
+    shuffle(possible_edges.begin(), possible_edges.end(), rng);
 
     std::vector<int> current_degrees(n);
     for (int i = 0; i < n; ++i)
@@ -2,12 +2,13 @@
 #define UTILS_H
 
 #include "def.hpp"
+#include "random.hpp"
 
 
-double getExponentialRandom(double mean);
-double getUniformRandom(double a, double b);
+double getExponentialRandom(RandomStream & rng, double mean);
+double getUniformRandom(RandomStream & rng, double a, double b);
 bool is_connected(const std::vector<std::unordered_set<int> >  &adj);
-std::vector<std::vector<int> > generate_graph(int n);
+std::vector<std::vector<int> > generate_graph(int n, RandomStream & rng);
 
 struct pair_hash {
     std::size_t operator()(const std::pair<int, int>& p) const {
@@ -15,14 +16,24 @@ struct pair_hash {
     }
 };
 
+/*
+    Block and transaction ids drawn by one miner: the miner id in the high bits and a sequence of its own in the
+    ID_SEQUENCE_BITS low bits, so ids never depend on which thread runs which miner or when
+    1) Sequences start at 1, id 0 is the genesis block
+    2) The low bits of a block id also mix in a digest of the block's content (combine()): the counter is restored
+       by an optimistic rollback, and a block built again from the same position but with other content must not
+       get the id of the first one
+*/
 class Counter {
 public:
-    static blockId_t getBlockID();
-    static txnId_t getTxnID();
-    
+    Counter(minerId_t owner = 0);
+    blockId_t getBlockID(uint64_t content);
+    txnId_t getTxnID();
+
+    static uint64_t combine(uint64_t digest, uint64_t value);
+
 private:
-    static blockId_t blockIDCount;  // Declaration
-    static txnId_t txnIDCount;      // Declaration
+    uint64_t next;
 };
 
 #endif
\ No newline at end of file
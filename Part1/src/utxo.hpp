@@ -3,23 +3,66 @@
 
 #include "def.hpp"
 
-struct Utxo
+/*
+    Identifies an output: the block holding the creating transaction, the transaction and the output index
+*/
+struct Outpoint
 {
-    /* data */
     blockId_t block;
     txnId_t txn;
     uint8_t index;
-    minerId_t owner;
+
+    bool operator == (const Outpoint & other) const {
+        return block == other.block && txn == other.txn && index == other.index;
+    }
+
+    bool operator < (const Outpoint & other) const {
+        return std::tie(block, txn, index) < std::tie(other.block, other.txn, other.index);
+    }
+
+    size_t hash() const {
+        // splitmix64 finaliser over the packed fields
+        uint64_t x = block * 0x9e3779b97f4a7c15ULL ^ (txn << 8 | index);
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+};
+
+struct OutpointHash
+{
+    size_t operator()(const Outpoint & outpoint) const {
+        return outpoint.hash();
+    }
+};
+
+/*
+    Output of a transaction, packed in 32 bytes with no heap member so that copying one (or a vector of them)
+    is a plain memcpy; who spends it is tracked by the trees' UtxoSet views, not by the output itself
+*/
+struct Utxo
+{
+    blockId_t block;
+    txnId_t txn;
     uint64_t amount;
-    std::vector<blockId_t> consumedBy;
+    uint32_t owner;         // minerId_t narrowed, miner ids are dense indices
+    uint8_t index;
+
+    Utxo() = default;
+
     Utxo(blockId_t block, txnId_t txn, uint8_t index, minerId_t owner, uint64_t amount): 
         block(block), 
         txn(txn), 
-        index(index), 
-        owner(owner), 
         amount(amount),
-        consumedBy(std::vector<blockId_t> (0, 0))
-    {}
+        owner(static_cast<uint32_t>(owner)), 
+        index(index)
+    {
+        assert(owner <= std::numeric_limits<uint32_t>::max() && "miner id does not fit Utxo::owner");
+    }
+
+    Outpoint outpoint() const {
+        return Outpoint{block, txn, index};
+    }
 
     bool operator == (const Utxo & other) const {
         return (block == other.block) &&
@@ -34,9 +77,12 @@ struct Utxo
     }
 
     size_t dataSize() const {
-        return sizeof(Utxo) + consumedBy.capacity() * sizeof(blockId_t);
+        return sizeof(Utxo);
     }
 };
 
+static_assert(sizeof(Utxo) == 32, "Utxo is expected to stay packed in 32 bytes");
+static_assert(std::is_trivially_copyable<Utxo>::value, "Utxo must stay memcpy-able");
+static_assert(std::is_trivially_copyable<Outpoint>::value, "Outpoint must stay memcpy-able");
 
 #endif
\ No newline at end of file
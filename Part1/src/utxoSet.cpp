@@ -0,0 +1,161 @@
+#include "utxoSet.hpp"
+
+UtxoSet::UtxoSet() : root(nullptr), count(0) {}
+
+UtxoSet::UtxoSet(NodePtr root, size_t count) : root(std::move(root)), count(count) {}
+
+size_t UtxoSet::size() const {
+    return count;
+}
+
+bool UtxoSet::contains(const Outpoint & outpoint) const {
+    size_t hash = outpoint.hash();
+    const Node * node = root.get();
+    for (int shift = 0; node; shift += BITS) {
+        if (shift >= HASH_BITS) {
+            return std::any_of(node->slots.begin(), node->slots.end(), [&outpoint](const Slot & slot) { return slot.key == outpoint; });
+        }
+        uint32_t bit = 1u << ((hash >> shift) & 31);
+        if (!(node->bitmap & bit)) {
+            return false;
+        }
+        const Slot & slot = node->slots[__builtin_popcount(node->bitmap & (bit - 1))];
+        if (!slot.child) {
+            return slot.key == outpoint;
+        }
+        node = slot.child.get();
+    }
+    return false;
+}
+
+UtxoSet UtxoSet::insert(const Outpoint & outpoint) const {
+    NodePtr newRoot = insert(root, outpoint, outpoint.hash(), 0);
+    return newRoot == root ? *this : UtxoSet(newRoot, count + 1);
+}
+
+UtxoSet UtxoSet::erase(const Outpoint & outpoint) const {
+    NodePtr newRoot = erase(root, outpoint, outpoint.hash(), 0);
+    return newRoot == root ? *this : UtxoSet(newRoot, count - 1);
+}
+
+UtxoSet::NodePtr UtxoSet::makeNode(const Slot & first, size_t firstHash, const Slot & second, size_t secondHash, int shift) {
+    auto node = std::make_shared<Node>();
+    if (shift >= HASH_BITS) {
+        // Full 64-bit hash collision, fall back to a plain list
+        node->bitmap = 0;
+        node->slots = {first, second};
+        return node;
+    }
+    uint32_t firstIndex = (firstHash >> shift) & 31;
+    uint32_t secondIndex = (secondHash >> shift) & 31;
+    if (firstIndex == secondIndex) {
+        node->bitmap = 1u << firstIndex;
+        node->slots = {Slot{makeNode(first, firstHash, second, secondHash, shift + BITS), Outpoint()}};
+    } else {
+        node->bitmap = (1u << firstIndex) | (1u << secondIndex);
+        node->slots = firstIndex < secondIndex ? std::vector<Slot>{first, second} : std::vector<Slot>{second, first};
+    }
+    return node;
+}
+
+UtxoSet::NodePtr UtxoSet::insert(const NodePtr & node, const Outpoint & key, size_t hash, int shift) {
+    if (!node) {
+        auto leaf = std::make_shared<Node>();
+        leaf->bitmap = shift >= HASH_BITS ? 0 : 1u << ((hash >> shift) & 31);
+        leaf->slots = {Slot{nullptr, key}};
+        return leaf;
+    }
+    if (shift >= HASH_BITS) {
+        if (std::any_of(node->slots.begin(), node->slots.end(), [&key](const Slot & slot) { return slot.key == key; })) {
+            return node;
+        }
+        auto copy = std::make_shared<Node>(*node);
+        copy->slots.push_back(Slot{nullptr, key});
+        return copy;
+    }
+
+    uint32_t bit = 1u << ((hash >> shift) & 31);
+    size_t position = __builtin_popcount(node->bitmap & (bit - 1));
+    if (!(node->bitmap & bit)) {
+        auto copy = std::make_shared<Node>(*node);
+        copy->bitmap |= bit;
+        copy->slots.insert(copy->slots.begin() + position, Slot{nullptr, key});
+        return copy;
+    }
+
+    const Slot & slot = node->slots[position];
+    NodePtr child;
+    if (!slot.child) {
+        if (slot.key == key) {
+            return node;
+        }
+        child = makeNode(slot, slot.key.hash(), Slot{nullptr, key}, hash, shift + BITS);
+    } else {
+        child = insert(slot.child, key, hash, shift + BITS);
+        if (child == slot.child) {
+            return node;
+        }
+    }
+    auto copy = std::make_shared<Node>(*node);
+    copy->slots[position] = Slot{child, Outpoint()};
+    return copy;
+}
+
+UtxoSet::NodePtr UtxoSet::erase(const NodePtr & node, const Outpoint & key, size_t hash, int shift) {
+    if (!node) {
+        return node;
+    }
+    if (shift >= HASH_BITS) {
+        auto found = std::find_if(node->slots.begin(), node->slots.end(), [&key](const Slot & slot) { return slot.key == key; });
+        if (found == node->slots.end()) {
+            return node;
+        }
+        if (node->slots.size() == 1) {
+            return nullptr;
+        }
+        auto copy = std::make_shared<Node>(*node);
+        copy->slots.erase(copy->slots.begin() + (found - node->slots.begin()));
+        return copy;
+    }
+
+    uint32_t bit = 1u << ((hash >> shift) & 31);
+    if (!(node->bitmap & bit)) {
+        return node;
+    }
+    size_t position = __builtin_popcount(node->bitmap & (bit - 1));
+    const Slot & slot = node->slots[position];
+
+    Slot replacement{nullptr, Outpoint()};
+    bool removeSlot = false;
+    if (!slot.child) {
+        if (!(slot.key == key)) {
+            return node;
+        }
+        removeSlot = true;
+    } else {
+        NodePtr child = erase(slot.child, key, hash, shift + BITS);
+        if (child == slot.child) {
+            return node;
+        }
+        if (!child) {
+            removeSlot = true;
+        } else if (child->slots.size() == 1 && !child->slots[0].child) {
+            // Pull a lone leaf back up so that lookups stay as shallow as possible
+            replacement = child->slots[0];
+        } else {
+            replacement = Slot{child, Outpoint()};
+        }
+    }
+
+    if (removeSlot && node->slots.size() == 1) {
+        return nullptr;
+    }
+    auto copy = std::make_shared<Node>(*node);
+    if (removeSlot) {
+        copy->bitmap &= ~bit;
+        copy->slots.erase(copy->slots.begin() + position);
+    } else {
+        copy->slots[position] = replacement;
+    }
+    return copy;
+}
@@ -0,0 +1,50 @@
+#ifndef UTXO_SET_H
+#define UTXO_SET_H
+
+#include "utxo.hpp"
+
+/*
+    Persistent (immutable, structurally shared) set of unspent outpoints
+    1) Hash array mapped trie: 32-way nodes indexed by 5 bits of Outpoint::hash(), children compressed by a bitmap
+    2) insert() / erase() never modify a set, they return a new version that shares every untouched node
+       with the old one, so each BlockTreeNode can keep the full UTXO view of its chain for O(log32 n) extra nodes
+    3) Lookups cost O(log32 n), effectively constant for any realistic number of outputs
+    Only membership is stored, the output itself (owner, amount) lives in the block that created it
+*/
+class UtxoSet {
+    private:
+        struct Node;
+        using NodePtr = std::shared_ptr<const Node>;
+
+        struct Slot {
+            NodePtr child;      // nullptr for a leaf
+            Outpoint key;
+        };
+
+        struct Node {
+            uint32_t bitmap;            // Occupied 5-bit indices, unused by collision nodes
+            std::vector<Slot> slots;
+        };
+
+        static constexpr int BITS = 5;
+        static constexpr int HASH_BITS = 64;
+
+        NodePtr root;
+        size_t count;
+
+        UtxoSet(NodePtr root, size_t count);
+
+        static NodePtr insert(const NodePtr & node, const Outpoint & key, size_t hash, int shift);
+        static NodePtr erase(const NodePtr & node, const Outpoint & key, size_t hash, int shift);
+        static NodePtr makeNode(const Slot & first, size_t firstHash, const Slot & second, size_t secondHash, int shift);
+
+    public:
+        UtxoSet();
+
+        bool contains(const Outpoint & outpoint) const;
+        UtxoSet insert(const Outpoint & outpoint) const;
+        UtxoSet erase(const Outpoint & outpoint) const;
+        size_t size() const;
+};
+
+#endif
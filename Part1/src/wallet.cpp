@@ -0,0 +1,72 @@
+#include "wallet.hpp"
+
+Wallet::Wallet() : balance(0) {}
+
+void Wallet::add(const Utxo & utxo) {
+    Outpoint outpoint = utxo.outpoint();
+    if ( reserved.count(outpoint) || ! coins.emplace(outpoint, utxo).second ) {
+        return;
+    }
+    byAmount.emplace(utxo.amount, outpoint);
+    balance += utxo.amount;
+}
+
+void Wallet::take(const Outpoint & outpoint) {
+    auto found = coins.find(outpoint);
+    if ( found == coins.end() ) {
+        return;
+    }
+    byAmount.erase({found->second.amount, outpoint});
+    balance -= found->second.amount;
+    coins.erase(found);
+}
+
+void Wallet::remove(const Outpoint & outpoint) {
+    this->take(outpoint);
+}
+
+void Wallet::spend(const Outpoint & outpoint) {
+    this->take(outpoint);
+    reserved.erase(outpoint);
+}
+
+void Wallet::unspend(const Utxo & utxo) {
+    reserved.emplace(utxo.outpoint(), utxo);
+}
+
+std::vector<Utxo> Wallet::select(uint64_t amount, uint64_t & change) {
+    std::vector<Utxo> selected;
+    if ( amount == 0 || amount > balance ) {
+        return selected;
+    }
+
+    uint64_t total = 0;
+    auto fit = byAmount.lower_bound({amount, Outpoint{0, 0, 0}});
+    if ( fit != byAmount.end() ) {
+        selected.push_back(coins.at(fit->second));
+        total = fit->first;
+    } else {
+        for ( auto coin = byAmount.rbegin(); total < amount && selected.size() < MAX_TXN_INPUTS; coin++ ) {
+            selected.push_back(coins.at(coin->second));
+            total += coin->first;
+        }
+        if ( total < amount ) {
+            return std::vector<Utxo>();
+        }
+    }
+
+    for ( const Utxo & utxo : selected ) {
+        this->take(utxo.outpoint());
+        reserved.emplace(utxo.outpoint(), utxo);
+    }
+    change = total - amount;
+    return selected;
+}
+
+uint64_t Wallet::getBalance() const {
+    return balance;
+}
+
+size_t Wallet::size() const {
+    return coins.size();
+}
@@ -0,0 +1,62 @@
+#ifndef WALLET_H
+#define WALLET_H
+
+#include "utxo.hpp"
+
+/*
+    Coins of one miner that are spendable on the tip of its longest chain
+    1) Updated incrementally by the tree: add()/remove() when an output paying us joins or leaves the chain,
+       spend()/unspend() when a block spending one of our outputs does
+    2) Coins handed out by select() are reserved for the pending transaction spending them: they leave the balance
+       at once and are not handed out again, even if a reorg drops and later restores the block creating them,
+       until release() finds no pending transaction spending them any more (dropped, evicted or conflicted)
+    3) Indexed by amount, so select() is O(log n) per coin picked
+*/
+class Wallet {
+    private:
+        std::unordered_map<Outpoint, Utxo, OutpointHash> coins;        // Available coins
+        std::set<std::pair<uint64_t, Outpoint>> byAmount;               // Same coins ordered by amount
+        std::unordered_map<Outpoint, Utxo, OutpointHash> reserved;     // Spent by one of our pending transactions
+        uint64_t balance;
+
+        void take(const Outpoint & outpoint);
+
+    public:
+        Wallet();
+
+        void add(const Utxo & utxo);
+        void remove(const Outpoint & outpoint);
+        void spend(const Outpoint & outpoint);
+        void unspend(const Utxo & utxo);    /* The spending transaction went back to the mempool, still pending */
+
+        /*
+            Best fit: the smallest coin covering amount if there is one, otherwise the largest coins until covered
+            Selected coins are reserved; returns an empty vector (and reserves nothing) if the balance is too low or
+            MAX_TXN_INPUTS coins do not cover amount
+        */
+        std::vector<Utxo> select(uint64_t amount, uint64_t & change);
+
+        /*
+            Drops every reservation whose coin no pending transaction spends; the coin returns to the balance if it
+            is still unspent on the chain. O(reserved coins)
+        */
+        template <typename Pending, typename Unspent>
+        void release(Pending isPending, Unspent isUnspent) {
+            for ( auto it = reserved.begin(); it != reserved.end(); ) {
+                if ( isPending(it->first) ) {
+                    it++;
+                    continue;
+                }
+                Utxo utxo = it->second;
+                it = reserved.erase(it);
+                if ( isUnspent(utxo.outpoint()) ) {
+                    this->add(utxo);
+                }
+            }
+        }
+
+        uint64_t getBalance() const;
+        size_t size() const;
+};
+
+#endif
@@ -0,0 +1,91 @@
+#include "workerPool.hpp"
+
+WorkerPool::WorkerPool(size_t workers) : stopping(false) {
+    threads.reserve(workers);
+    for (size_t i = 0; i < workers; i++) {
+        threads.emplace_back(&WorkerPool::work, this);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread & thread : threads) {
+        thread.join();
+    }
+}
+
+WorkerPool & WorkerPool::shared() {
+    static WorkerPool pool(std::max(std::thread::hardware_concurrency(), 1u) - 1);
+    return pool;
+}
+
+size_t WorkerPool::size() const {
+    return threads.size();
+}
+
+void WorkerPool::runChunks(Loop & loop) {
+    size_t begin;
+    while ((begin = loop.next.fetch_add(loop.grain, std::memory_order_relaxed)) < loop.count) {
+        size_t end = std::min(loop.count, begin + loop.grain);
+        (*loop.task)(begin, end);
+        loop.done.fetch_add(end - begin, std::memory_order_release);
+    }
+}
+
+void WorkerPool::retire(const std::shared_ptr<Loop> & loop) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = std::find(loops.begin(), loops.end(), loop);
+    if (found != loops.end()) {
+        loops.erase(found);
+    }
+}
+
+void WorkerPool::work() {
+    while (true) {
+        std::shared_ptr<Loop> loop;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return stopping || ! loops.empty(); });
+            if (stopping) {
+                return;
+            }
+            loop = loops.front();
+        }
+        runChunks(*loop);
+        // Every chunk is claimed, nobody else needs to find this loop
+        retire(loop);
+    }
+}
+
+void WorkerPool::parallelFor(size_t count, size_t grain, const Task & task) {
+    grain = std::max<size_t>(grain, 1);
+    if (threads.empty() || count <= grain) {
+        task(0, count);
+        return;
+    }
+
+    std::shared_ptr<Loop> loop = std::make_shared<Loop>();
+    loop->task = &task;
+    loop->count = count;
+    loop->grain = grain;
+    loop->next = 0;
+    loop->done = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        loops.push_back(loop);
+    }
+    wake.notify_all();
+
+    runChunks(*loop);
+    retire(loop);
+    // Waiting for the chunks claimed by workers, they are short so spinning beats sleeping
+    for (size_t spins = 0; loop->done.load(std::memory_order_acquire) < count; spins++) {
+        if (spins > 1024) {
+            std::this_thread::yield();
+        }
+    }
+}
@@ -0,0 +1,55 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include "def.hpp"
+#include <thread>
+#include <condition_variable>
+
+/*
+    Fixed set of worker threads running data-parallel loops
+    1) parallelFor() splits [0, count) in chunks of grain indices, workers and the calling thread claim chunks
+       from a shared counter until none is left, so a slow chunk never holds back the others
+    2) Several threads may call parallelFor() at once (e.g. the partitions of a parallel scheduler), idle workers
+       help the oldest loop still having unclaimed chunks
+    3) Loops of at most one chunk, or a pool without workers, run inline on the calling thread
+    Tasks must not throw
+*/
+class WorkerPool {
+    public:
+        using Task = std::function<void(size_t begin, size_t end)>;
+
+    private:
+        struct Loop {
+            const Task * task;
+            size_t count;
+            size_t grain;
+            std::atomic<size_t> next;
+            std::atomic<size_t> done;
+        };
+
+        std::vector<std::thread> threads;
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::deque<std::shared_ptr<Loop>> loops;    // Loops with chunks left to claim, oldest first
+        bool stopping;
+
+        static void runChunks(Loop & loop);
+        void work();
+        void retire(const std::shared_ptr<Loop> & loop);
+
+    public:
+        WorkerPool(size_t workers);
+        ~WorkerPool();
+        WorkerPool(const WorkerPool &) = delete;
+        WorkerPool & operator=(const WorkerPool &) = delete;
+
+        void parallelFor(size_t count, size_t grain, const Task & task);
+        size_t size() const;
+
+        /*
+            Process-wide pool with one worker per hardware thread besides the caller's, started on first use
+        */
+        static WorkerPool & shared();
+};
+
+#endif
@@ -0,0 +1,181 @@
+#include "../src/trace.hpp"
+#include "../src/metrics.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+/*
+    Rebuilds per-miner block trees and block propagation statistics from a trace written by ./sim
+    1) The file is streamed one chunk at a time (mapped read-only, read sequentially, then unmapped), so memory
+       use depends on the number of blocks, not on the length of the trace
+    2) Chunks are not in time order, so nothing here depends on the order of the records
+    Usage: ./traceReader trace.bin
+*/
+
+struct MinerTree {
+    std::unordered_map<blockId_t, blockId_t> parents;       // Accepted blocks and their parent
+    uint64_t reorgs = 0;
+    uint64_t maxReorgDepth = 0;
+};
+
+struct Summary {
+    uint64_t records = 0;
+    uint64_t events[Metrics::EVENT_TYPES] = {};
+    simTime_t firstTime = std::numeric_limits<simTime_t>::max();
+    simTime_t lastTime = 0;
+    std::vector<MinerTree> trees;
+    std::unordered_map<blockId_t, std::vector<simTime_t> > acceptTimes;    // Every miner's accept time of a block
+
+    MinerTree & tree(uint32_t miner) {
+        if (miner >= trees.size()) {
+            trees.resize(miner + 1);
+        }
+        return trees[miner];
+    }
+
+    void add(const TraceRecord & record) {
+        records++;
+        firstTime = std::min(firstTime, record.time);
+        lastTime = std::max(lastTime, record.time);
+        switch (record.kind) {
+            case TraceKind::DELIVERY:
+                if (record.eventType < Metrics::EVENT_TYPES) {
+                    events[record.eventType]++;
+                }
+                break;
+            case TraceKind::BLOCK_ACCEPTED:
+                if (tree(record.miner).parents.emplace(record.id, record.aux).second) {
+                    acceptTimes[record.id].push_back(record.time);
+                }
+                break;
+            case TraceKind::REORG: {
+                MinerTree & minerTree = tree(record.miner);
+                minerTree.reorgs++;
+                minerTree.maxReorgDepth = std::max(minerTree.maxReorgDepth, record.aux);
+                break;
+            }
+            default:
+                break;
+        }
+    }
+};
+
+/*
+    Height of every block of a tree, the genesis block (never traced) being at height 0
+*/
+static std::unordered_map<blockId_t, int> heights(const MinerTree & tree) {
+    std::unordered_map<blockId_t, int> height;
+    std::vector<blockId_t> path;
+    for (const auto & entry : tree.parents) {
+        blockId_t block = entry.first;
+        while (!height.count(block) && tree.parents.count(block)) {
+            path.push_back(block);
+            block = tree.parents.at(block);
+        }
+        int base = height.count(block) ? height[block] : 0;
+        for (auto it = path.rbegin(); it != path.rend(); it++) {
+            height[*it] = ++base;
+        }
+        path.clear();
+    }
+    return height;
+}
+
+static void printDistribution(const std::string & name, std::vector<double> values) {
+    if (values.empty()) {
+        std::cout << name << ": no samples" << std::endl;
+        return;
+    }
+    std::sort(values.begin(), values.end());
+    auto percentile = [&](double p) { return values[std::min(values.size() - 1, size_t(p * values.size()))]; };
+    double mean = std::accumulate(values.begin(), values.end(), 0.0) / values.size();
+    std::cout << name << ": " << values.size() << " samples, mean " << mean << "s, p50 " << percentile(0.5)
+              << "s, p90 " << percentile(0.9) << "s, p99 " << percentile(0.99) << "s, max " << values.back() << "s" << std::endl;
+}
+
+static bool readTrace(const std::string & path, Summary & summary) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Error opening trace file: " << path << std::endl;
+        return false;
+    }
+    TraceHeader header;
+    if (pread(fd, &header, sizeof(header), 0) != sizeof(header) || !std::equal(TRACE_MAGIC, TRACE_MAGIC + 8, header.magic)
+        || header.version != TRACE_VERSION || header.recordSize != sizeof(TraceRecord)) {
+        std::cerr << "Not a trace file (or not closed by the simulator): " << path << std::endl;
+        close(fd);
+        return false;
+    }
+    size_t chunkBytes = header.chunkRecords * sizeof(TraceRecord);
+    for (uint64_t chunk = 0; chunk < header.chunks; chunk++) {
+        void * mapping = mmap(nullptr, chunkBytes, PROT_READ, MAP_PRIVATE, fd, TRACE_HEADER_BYTES + chunk * chunkBytes);
+        if (mapping == MAP_FAILED) {
+            std::cerr << "Error mapping chunk " << chunk << " of " << path << std::endl;
+            close(fd);
+            return false;
+        }
+        madvise(mapping, chunkBytes, MADV_SEQUENTIAL);
+        const TraceRecord * records = static_cast<const TraceRecord *>(mapping);
+        for (size_t i = 0; i < header.chunkRecords && records[i].kind != TraceKind::EMPTY; i++) {
+            summary.add(records[i]);
+        }
+        munmap(mapping, chunkBytes);
+    }
+    close(fd);
+    return true;
+}
+
+int main(int argc, char * argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " trace.bin" << std::endl;
+        return 1;
+    }
+    Summary summary;
+    if (!readTrace(argv[1], summary)) {
+        return 1;
+    }
+    size_t numMiners = summary.trees.size();
+    std::cout << "Trace: " << summary.records << " records, " << numMiners << " miners, from " << summary.firstTime
+              << "s to " << summary.lastTime << "s" << std::endl;
+    for (size_t i = 0; i < Metrics::EVENT_TYPES; i++) {
+        if (summary.events[i]) {
+            std::cout << "  " << Metrics::eventName(static_cast<EventType>(i)) << ": " << summary.events[i] << std::endl;
+        }
+    }
+
+    for (size_t miner = 0; miner < numMiners; miner++) {
+        const MinerTree & tree = summary.trees[miner];
+        std::unordered_map<blockId_t, int> height = heights(tree);
+        int tipHeight = 0;
+        std::unordered_map<blockId_t, int> children;
+        for (const auto & entry : tree.parents) {
+            tipHeight = std::max(tipHeight, height[entry.first]);
+            children[entry.second]++;
+        }
+        size_t forks = std::count_if(children.begin(), children.end(), [](const auto & entry) { return entry.second > 1; });
+        std::cout << "Miner " << miner << ": " << tree.parents.size() << " blocks, height " << tipHeight << ", "
+                  << tree.parents.size() - tipHeight << " off the longest chain, " << forks << " forks, "
+                  << tree.reorgs << " reorgs (deepest " << tree.maxReorgDepth << ")" << std::endl;
+    }
+
+    // Delays are measured from the first miner to accept a block, its creator
+    std::vector<double> toPeer, toHalf, toAll;
+    for (auto & entry : summary.acceptTimes) {
+        std::vector<simTime_t> & times = entry.second;
+        std::sort(times.begin(), times.end());
+        for (size_t i = 1; i < times.size(); i++) {
+            toPeer.push_back(times[i] - times[0]);
+        }
+        if (times.size() * 2 >= numMiners) {
+            toHalf.push_back(times[(numMiners + 1) / 2 - 1] - times[0]);
+        }
+        if (times.size() == numMiners) {
+            toAll.push_back(times.back() - times[0]);
+        }
+    }
+    std::cout << "Propagation of " << summary.acceptTimes.size() << " blocks" << std::endl;
+    printDistribution("  to a miner", toPeer);
+    printDistribution("  to half of the miners", toHalf);
+    printDistribution("  to every miner", toAll);
+    return 0;
+}